@@ -0,0 +1,62 @@
+// Measures the boot time of an ESPConfig object read from several JSON
+// configuration files, with and without the compiled image cache.
+//
+// Build with the cache enabled and a document large enough for the files,
+// e.g. in platformio.ini:
+//   build_flags = -DESPCONFIG_CACHE=1 -DESPCONFIG_JSONDOCSIZE=24576
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <ESPConfig.hpp>
+
+#if !ESPCONFIG_CACHE
+# error "build with -DESPCONFIG_CACHE=1"
+#endif
+
+const std::vector<const char*> configFiles{
+  "/device.json", "/network.json", "/sensors.json"};
+constexpr auto runs{10};
+
+// write a file of about size bytes holding an array of similar objects
+void writeConfig(const char* fileName, const char* prefix, size_t size) {
+  auto file{LittleFS.open(fileName, "w")};
+  file.printf("{\n  // %s settings\n  \"%s\": [\n", prefix, prefix);
+  for (auto i{0}; file.size() < size; i++) {
+    file.printf("%s    {\"name\": \"%s%d\", \"enabled\": %s, \"gain\": %d.%d, "
+                "\"pins\": [%d, %d], \"unit\": \"mV\"}",
+                i ? ",\n" : "", prefix, i, i % 2 ? "true" : "false", i, i % 10,
+                i % 40, (i + 1) % 40);
+  }
+  file.printf("\n  ],\n  \"%sVersion\": 3\n}\n", prefix);
+  file.close();
+}
+
+unsigned long bootTime() {
+  auto start{micros()};
+  ESPConfig config{configFiles, &LittleFS, [](ESPConfig::fileSystem_t) {},
+                   [](ESPConfig::fileSystem_t) {}, false};
+  return micros() - start;
+}
+
+void setup() {
+  Serial.begin(115200);
+  LittleFS.begin();
+
+  writeConfig("/device.json", "device", 2048);
+  writeConfig("/network.json", "network", 1024);
+  writeConfig("/sensors.json", "sensors", 4096);
+
+  unsigned long miss{0}, hit{0};
+  for (auto i{0}; i < runs; i++) {
+    LittleFS.remove("/device.json" ESPCONFIG_CACHESUFFIX);
+    miss += bootTime();  // parse the files and write the cache
+    hit += bootTime();   // load the cache
+  }
+
+  Serial.printf("ESPConfig boot, average of %d runs\n", runs);
+  Serial.printf("  parse and write cache: %lu us\n", miss / runs);
+  Serial.printf("  load cache:            %lu us\n", hit / runs);
+}
+
+void loop() {}
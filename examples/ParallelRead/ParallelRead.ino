@@ -0,0 +1,79 @@
+// Compares reading many JSON configuration files one at a time with parsing
+// them in parallel on the two ESP32 cores. The values read must match.
+//
+// Parsing in parallel is opt-in. Each parsing thread needs its own document
+// and stack, so the JSON document size is held once per file parsed at once
+// plus ESPCONFIG_PARALLELSTACK per extra thread, e.g. in platformio.ini:
+//   build_flags = -DESPCONFIG_PARALLEL=2 -DESPCONFIG_JSONDOCSIZE=8192
+// The file system must allow files to be read from both threads at once, as
+// LittleFS does on the ESP32.
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <ESPConfig.hpp>
+
+#if ESPCONFIG_PARALLEL < 2
+# error "build with -DESPCONFIG_PARALLEL=2 or more"
+#endif
+
+constexpr auto fileCount{16};
+constexpr auto runs{5};
+
+std::vector<std::string> fileNames{};
+std::vector<const char*> configFiles{};
+
+// write a file of about size bytes, every file sets "shared" so the merge
+// order decides its value
+void writeConfig(const char* fileName, int number, size_t size) {
+  auto file{LittleFS.open(fileName, "w")};
+  file.printf("{\n  \"shared\": %d,\n  \"device%d\": [\n", number, number);
+  for (auto i{0}; file.size() < size; i++) {
+    file.printf("%s    {\"name\": \"sensor%d\", \"enabled\": %s, "
+                "\"gain\": %d.%d, \"pins\": [%d, %d]}",
+                i ? ",\n" : "", i, i % 2 ? "true" : "false", i, i % 10,
+                i % 40, (i + 1) % 40);
+  }
+  file.printf("\n  ]\n}\n");
+  file.close();
+}
+
+unsigned long readTime(uint8_t parallel, std::string& result) {
+  auto start{micros()};
+  ESPConfig config{std::unique_ptr<ESPConfigStorage>{new ESPConfigFileStorage{
+      configFiles, &LittleFS, [](ESPConfig::fileSystem_t) {},
+      [](ESPConfig::fileSystem_t) {}, parallel}}};
+  auto elapsed{micros() - start};
+  result = config.toJSON();
+  return elapsed;
+}
+
+void setup() {
+  Serial.begin(115200);
+  LittleFS.begin();
+
+  for (auto i{0}; i < fileCount; i++) {
+    fileNames.push_back("/config" + std::to_string(i) + ".json");
+  }
+  for (auto i{0}; i < fileCount; i++) {
+    configFiles.push_back(fileNames[i].c_str());
+    writeConfig(configFiles[i], i, 2048);
+  }
+
+  unsigned long sequential{0}, parallel{0};
+  std::string sequentialJSON{}, parallelJSON{};
+  for (auto i{0}; i < runs; i++) {
+    sequential += readTime(1, sequentialJSON);
+    parallel += readTime(ESPCONFIG_PARALLEL, parallelJSON);
+  }
+
+  Serial.printf("ESPConfig read of %d files, average of %d runs\n", fileCount,
+                runs);
+  Serial.printf("  sequential:       %lu us\n", sequential / runs);
+  Serial.printf("  %u files at once: %lu us\n", ESPCONFIG_PARALLEL,
+                parallel / runs);
+  Serial.printf("  results %s\n",
+                sequentialJSON == parallelJSON ? "match" : "differ");
+}
+
+void loop() {}
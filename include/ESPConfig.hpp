@@ -7,12 +7,19 @@
 #include <StreamUtils.h>
 
 #include <array>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "ESPConfigImage.hpp"
+#include "ESPConfigPaged.hpp"
+
 // ESP32 does not support std::varient at this time
 #if __has_include(<variant>)
 # include <variant>
@@ -30,23 +37,102 @@
 # define ESPCONFIG_JSONDOCSIZE 1024u
 #endif
 
+// the number of named segments the EEPROM area can be divided into
+#ifndef ESPCONFIG_SEGMENTS
+# define ESPCONFIG_SEGMENTS 8u
+#endif
+
+// cache the parsed configuration files as an image, see README.md
+#ifndef ESPCONFIG_CACHE
+# define ESPCONFIG_CACHE 0
+#endif
+
+#ifndef ESPCONFIG_CACHESUFFIX
+# define ESPCONFIG_CACHESUFFIX ".cache"
+#endif
+
+#ifndef ESPCONFIG_CACHEHASH
+# define ESPCONFIG_CACHEHASH 1
+#endif
+
+// top level arrays of this many elements stay in the cache file, see README.md
+#ifndef ESPCONFIG_PAGEDARRAY
+# define ESPCONFIG_PAGEDARRAY 0u
+#endif
+
+// the configuration files parsed at once, more than 1 parses them in threads,
+// see README.md for the file system and memory requirements
+#ifndef ESPCONFIG_PARALLEL
+# define ESPCONFIG_PARALLEL 1u
+#endif
+
+// the stack size of the ESP32 threads parsing configuration files
+#ifndef ESPCONFIG_PARALLELSTACK
+# define ESPCONFIG_PARALLELSTACK 6144u
+#endif
+
+// count lookups, reads, saves and more, see README.md
+#ifndef ESPCONFIG_STATS
+# define ESPCONFIG_STATS 0
+#endif
+
+// compress the saved configuration, see README.md
+#ifndef ESPCONFIG_COMPRESS
+# define ESPCONFIG_COMPRESS 0
+#endif
+
+// save the keys in strcmp order, see README.md
+#ifndef ESPCONFIG_SORTKEYS
+# define ESPCONFIG_SORTKEYS 0
+#endif
+
 #ifndef ESPCONFIG_SAVEDKEY
 # define ESPCONFIG_SAVEDKEY F("ESPConfigSaved")
 #endif
 
 constexpr auto m_eepromSize{ESPCONFIG_EEPROMSIZE};
 constexpr auto m_jsonDocSize{ESPCONFIG_JSONDOCSIZE};
+constexpr uint32_t m_cacheMagic{0x32464345};  // "ECF2"
+constexpr uint32_t m_segmentMagic{0x53464345};  // "ECFS"
+constexpr auto m_segmentCount{ESPCONFIG_SEGMENTS};
+constexpr auto m_pagedArray{ESPCONFIG_PAGEDARRAY};
+
+class ESPConfigStorage;
 
 class ESPConfig {
   public:
     using ESPConfigP_t = ESPConfig*;
     using fileSystem_t = fs::FS*;
     using mountCallBack_t = std::function<void(fileSystem_t fileSys)>;
+    using usageCallBack_t =
+        std::function<void(const char* path, size_t index, size_t bytes)>;
     enum class saveFormat: uint8_t {
       minified,
       pretty,
       msgPack
     };
+    struct segment_t {
+      const char* name;
+      uint16_t size;
+    };
+  #if ESPCONFIG_STATS
+    struct stats_t {
+      uint32_t lookups;
+      uint32_t hits;
+      uint32_t misses;
+      uint32_t allocations;
+      uint32_t keys;
+      uint32_t bytesHeld;
+      uint32_t reads;
+      uint32_t readMicros;
+      uint32_t readBytes;
+      uint32_t saves;
+      uint32_t saveMicros;
+      uint32_t saveBytes;
+      uint32_t eepromCommits;
+      uint32_t overflows;
+    };
+  #endif
 
     ESPConfig();
 
@@ -62,20 +148,50 @@ class ESPConfig {
         mountCallBack_t unmountCB = [](fileSystem_t fileSys) {},
         const bool useEeprom = true);
 
+    explicit ESPConfig(const segment_t& segment);
+
+    explicit ESPConfig(std::unique_ptr<ESPConfigStorage> storage);
+
     ESPConfig(JsonObjectConst json);
 
+    explicit ESPConfig(const ESPConfigImage& image);
+
     ~ESPConfig();
     ESPConfig& read();
     ESPConfig& read(const char* jsonStr);
     ESPConfig& read(const char* jsonStr, size_t jsonStrLen);
+    ESPConfig& applyPatch(const char* patch);
+    ESPConfig& applyPatch(const char* patch, size_t patchLen);
     ESPConfig& remove(const char* key);
     ESPConfig& reset();
-    void save() const;
+    bool save() const;
+    bool changed() const;
     template <typename T> bool is(const char* key) const;
     template <typename T> ESPConfig& value(const char* key, T value);
     template <typename T> T value(const char* key) const;
+    template <typename T>
+    ESPConfigImage::arrayView<T> view(const char* key) const;
+    template <typename T>
+    ESPConfigPagedArray<T> paged(const char* key) const;
+    class valueView;
+    class resolvedPath;
+    resolvedPath resolve(const char* path) const;
+    template <typename F> void forEach(F&& callBack) const;
+    template <typename T, typename F> void forEach(F&& callBack) const;
     const std::vector<std::string> keys() const;
     std::string toJSON(saveFormat format = saveFormat::minified) const;
+    std::string diff(const ESPConfig& base,
+                     saveFormat format = saveFormat::minified) const;
+    template <typename S, typename Schema>
+    ESPConfig& bind(S& object, const Schema& schema);
+    ESPConfig& defaults(const ESPConfigImage& image);
+    size_t memoryUsage(const usageCallBack_t& callBack = nullptr) const;
+    ESPConfig& compact();
+  #if ESPCONFIG_STATS
+    stats_t stats() const;
+    std::string statsJSON(saveFormat format = saveFormat::minified) const;
+    static void resetStats();
+  #endif
 
    private:
   #if __has_include(<variant>)
@@ -105,16 +221,162 @@ class ESPConfig {
    using configValue_t = linb::any;
   #endif
 
+  public:
+    // A non-owning view of a stored value, only valid during forEach
+    class valueView {
+      public:
+        template <typename T> bool is() const;
+        template <typename T> const T& as() const;
+        size_t index() const { return m_index; }
+
+      private:
+        friend class ESPConfig;
+        valueView(const configValue_t& value, const size_t index)
+            : m_value{value}, m_index{index} {}
+
+        const configValue_t& m_value;
+        const size_t m_index;
+    };
+
+    // A cached lookup of a path, re-resolved only after the tree changes
+    class resolvedPath {
+      public:
+        template <typename T> bool is() const;
+        template <typename T> T value() const;
+
+      private:
+        friend class ESPConfig;
+        resolvedPath(const ESPConfig& config, const char* path)
+            : m_config{config}, m_path{path}, m_revision{ESPConfig::m_revision - 1} {}
+        const configValue_t* node() const;
+
+        const ESPConfig& m_config;
+        const std::string m_path;
+        mutable const configValue_t* m_node{nullptr};
+        mutable bool m_isDefault{false};
+        mutable ESPConfigImage::entry_t m_default;
+        mutable uint32_t m_revision;
+    };
+
+    // Keys held in a plain struct instead of m_config, see ESPConfigSchema.hpp
+    class schemaBinding {
+      public:
+        virtual ~schemaBinding() = default;
+        virtual size_t size() const = 0;
+        virtual const char* key(size_t index) const = 0;
+        virtual bool readValue(const char* key, JsonVariantConst value) = 0;
+        virtual void writeJson(JsonObject json) const = 0;
+    };
+
+  private:
+    template <typename T> static bool holds(const configValue_t* value);
+    template <typename T> static const T& get(const configValue_t& value);
+    template <typename T> static bool isValue(const configValue_t* value);
+    template <typename T> static T toValue(const configValue_t* value);
+    template <typename T>
+    T defaultValue(const ESPConfigImage::entry_t& entry) const;
+    const configValue_t* lookup(const char* path) const;
+    const configValue_t* walk(const char* path) const;
+    size_t indexOf(const configValue_t& value) const;
+    void release(const configValue_t& value) const;
     void readJson(JsonObjectConst json);
+    void readValue(const char* key, JsonVariantConst val);
+    template <typename T> void replace(const char* key, T val);
+    void applyJson(JsonObjectConst patch);
+    static void diffJson(JsonObjectConst source, JsonObjectConst target,
+                         JsonObject patch);
+    void readImage(const ESPConfigImage& image, uint32_t node,
+                   uint32_t resident = UINT32_MAX);
+    bool pagedSource(const char* key, ESPConfigPager::source_t& source) const;
+    void readPaged(const char* key, const ESPConfigPager::source_t& source);
+    void writeJson(JsonObject json) const;
+    static void writePaged(JsonObject json, const char* key,
+                           const ESPConfigPager::source_t& source);
+    static void writeValue(JsonObject json, const char* key,
+                           const valueView& val);
     DynamicJsonDocument toJSONObj() const;
+    ESPConfig& bind(std::unique_ptr<schemaBinding> binding);
+    void moveToBinding();
+    ESPConfig& store(const char* key, configValue_t value);
+    size_t keyUsage(const usageCallBack_t& callBack,
+                    const std::string& prefix) const;
+    size_t valueUsage(const configValue_t& value) const;
+    configValue_t compacted(const configValue_t& value) const;
+    ESPConfigP_t compacted(ESPConfigP_t child) const;
+
+    // an image is written straight from the values, see ESPConfigImage.hpp
+    friend class ESPConfigImage;
+
+    // keys changed since the last read or save, and keys listed by a storage
+    // but only loaded when first used, see ESPConfigStorage.hpp
+    friend class ESPConfigStorage;
+    bool dirty() const;
+    static bool dirty(const configValue_t& value);
+    static std::vector<ESPConfigP_t> children(const configValue_t& value);
+    void clean() const;
+    void clean(const char* key) const;
+    void writeDirty(JsonObject json, std::vector<std::string>& removed) const;
+    void defer(const char* key, ESPConfigStorage* storage);
+    bool loadPending(const char* key, size_t keyLen) const;
+    void loadPending() const;
+    std::vector<std::pair<const std::string*, ESPConfigPager::source_t>>
+    pagedPending() const;
+
+    // keys are interned in a table shared by a config and the nested configs
+    // it creates, so each distinct key is stored once and hashed by address.
+    // The table lists the configs using it, so purgeKeys() can drop the keys
+    // none of them holds. Each key is a view of the string in its own node, so
+    // a key is found without building a std::string.
+    struct keyTable_t {
+      std::unordered_map<std::string_view, std::string> keys;
+      std::unordered_set<const ESPConfig*> users;
+
+      const std::string* find(std::string_view key) const;
+      const std::string* intern(std::string_view key);
+    };
+    using config_t = std::unordered_map<const std::string*, configValue_t>;
+
+    ESPConfig(JsonObjectConst json, const std::shared_ptr<keyTable_t>& keys);
+    const std::string* intern(const char* key);
+    void purgeKeys() const;
+    void adoptKeys(const std::shared_ptr<keyTable_t>& keys);
+    void compactValues();
+    config_t::iterator find(const char* key);
+    config_t::const_iterator find(const char* key, size_t keyLen) const;
 
-    std::unordered_map<std::string, configValue_t> m_config;
+    std::shared_ptr<keyTable_t> m_keys{std::make_shared<keyTable_t>()};
+    config_t m_config;
+    mutable std::unordered_set<const std::string*> m_dirty;
+    mutable bool m_saved{false};  // set by a storage that saved the config
+    std::unordered_map<const std::string*, ESPConfigStorage*> m_pending;
+
+    // bumped whenever a stored value may have been destroyed, shared by all
+    // instances so a change anywhere in a tree invalidates resolved paths.
+    // Atomic where instances may live on different threads, an instance and
+    // the configs sharing its keys are still used by one thread at a time.
+  #if defined(ESP8266)
+    using revision_t = uint32_t;  // one core, no threads
+  #else
+    using revision_t = std::atomic<uint32_t>;
+  #endif
+    static revision_t m_revision;
+  #if ESPCONFIG_STATS
+    static stats_t m_stats;  // shared by all instances
+  #endif
+
+    std::unique_ptr<schemaBinding> m_binding;
+    ESPConfigImage m_defaults;
+  #if defined(ESP8266)
+    // strings of the defaults image copied out of flash by their offset
+    mutable std::unordered_map<uint32_t, std::string> m_defaultStrings;
+  #endif
 
-    fileSystem_t m_fileSys;
-    const std::vector<const char*> m_configFileList;
-    const bool m_useEeprom;
-    const mountCallBack_t m_mountCB;
-    const mountCallBack_t m_unmountCB;
+    // read in turn by read(), m_saveStorage is the one written by save()
+    std::vector<std::unique_ptr<ESPConfigStorage>> m_storage;
+    ESPConfigStorage* m_saveStorage{nullptr};
 };
 
 #include "ESPConfig_impl.hpp"
+#include "ESPConfigSchema.hpp"
+#include "ESPConfigStorage.hpp"
+#include "ESPConfigScheduler.hpp"
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ESPConfig;
+
+// A read only config image accessed in place, either a PROGMEM array generated
+// by tools/espconfig_image.py or any other region holding the same layout.
+//
+// All values are little endian and every offset is from the image start.
+//
+//   header  uint32 magic "ECFG", uint16 version, uint16 flags,
+//           uint32 image size, uint32 root node offset
+//   node    uint32 entry count, then the entries sorted by key (strcmp)
+//   entry   uint32 key offset, uint8 type, uint8[3] padding,
+//           uint32 count, uint32 value
+//
+// The entry type is the index of the value in the Supported Value Types
+// table. bool and int32_t values are held in the value field, a string has its
+// length in count, every other value field is the offset of the data:
+// a double, a NUL terminated string, a node, or count array elements of
+// uint8 (bool), int32, double, or uint32 string or node offsets.
+//
+// An image may also be mapped from a flash partition on the ESP32 or from a
+// file on a host, the values are then read in place from the mapping.
+//
+// The whole image is checked once when it is constructed, so every offset
+// read afterwards lies inside it and every string is NUL terminated. When only
+// the first loaded bytes are held, the bool, int32_t and double arrays after
+// them read as empty and are left to the caller, see ESPConfigFileStorage.
+class ESPConfigImage {
+  public:
+    struct entry_t {
+      uint32_t key;
+      uint8_t type;
+      uint32_t count;
+      uint32_t value;
+    };
+
+    // A view of the elements of an array of bool, int32_t, double or
+    // const char* held in an image, or of an int32_t or double array in RAM.
+    // It holds plain pointers, valid only while that data is not freed.
+    template <typename T>
+    class arrayView {
+      public:
+        arrayView() = default;
+        arrayView(const uint8_t* base, const uint8_t* data, size_t count)
+            : m_base{base}, m_data{data}, m_count{count} {}
+
+        size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+        T operator[](size_t index) const;
+
+      private:
+        const uint8_t* m_base{nullptr};
+        const uint8_t* m_data{nullptr};
+        size_t m_count{0};
+    };
+
+    static constexpr uint32_t magic{0x47464345};  // "ECFG"
+    static constexpr uint16_t version{1};
+    static constexpr size_t headerSize{16};
+    static constexpr size_t entrySize{16};
+
+    ESPConfigImage() = default;
+    ESPConfigImage(const uint8_t* data, size_t size, size_t loaded = SIZE_MAX);
+  #if defined(ESP32)
+    static ESPConfigImage mapPartition(const char* label);
+  #elif defined(__unix__) || defined(__APPLE__)
+    static ESPConfigImage mapFile(const char* fileName);
+  #endif
+
+    // with tailCount set the top level bool, int32_t and double arrays of at
+    // least tailCount elements are placed after all of the other data
+    static std::string build(JsonObjectConst json, size_t tailCount = 0);
+    static std::string build(const ESPConfig& config, size_t tailCount = 0);
+
+    explicit operator bool() const { return m_root != 0; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    uint32_t root() const { return m_root; }
+
+    bool lookup(const char* path, entry_t& entry) const;
+    template <typename F> void forEach(uint32_t node, F&& callBack) const;
+    std::string key(const entry_t& entry) const;
+    uint32_t node(const entry_t& entry, size_t index) const;
+    template <typename T> bool is(const entry_t& entry) const;
+    template <typename T> T value(const entry_t& entry) const;
+    template <typename T> arrayView<T> array(const entry_t& entry) const;
+
+  private:
+    class imageWriter;
+    bool valid() const;
+    bool inside(uint32_t offset, size_t count, size_t elemSize,
+                size_t limit) const {
+      return offset <= limit && count <= (limit - offset) / elemSize;
+    }
+    bool resident(const entry_t& entry) const {
+      return entry.value < m_loaded;
+    }
+    bool find(uint32_t node, const char* key, size_t keyLen,
+              entry_t& entry) const;
+    entry_t entryAt(uint32_t offset) const;
+    template <typename T> T read(uint32_t offset) const {
+      T val;
+      memcpy_P(&val, m_data + offset, sizeof(T));
+      return val;
+    }
+
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+    size_t m_loaded{0};  // the bytes held at m_data
+    uint32_t m_root{0};
+    std::shared_ptr<const void> m_mapping;  // unmaps when the last copy goes
+};
+
+// ---- forEach ----
+
+// call callBack(const entry_t& entry) for each entry of a node in key order
+template <typename F>
+inline void ESPConfigImage::forEach(uint32_t node, F&& callBack) const {
+  if (!*this || !inside(node, 1, sizeof(uint32_t), m_loaded)) {
+    return;
+  }
+  auto count{read<uint32_t>(node)};
+  if (!inside(node + sizeof(uint32_t), count, entrySize, m_loaded)) {
+    return;
+  }
+  for (auto i{0u}; i < count; i++) {
+    callBack(entryAt(node + sizeof(uint32_t) + i * entrySize));
+  }
+}
+
+// ---- is ----
+
+template <typename T>
+inline bool ESPConfigImage::is(const entry_t& entry) const {
+  return false;
+}
+
+template <>
+inline bool ESPConfigImage::is<bool>(const entry_t& entry) const {
+  return entry.type == 0;
+}
+
+template <>
+inline bool ESPConfigImage::is<int32_t>(const entry_t& entry) const {
+  return entry.type == 1;
+}
+
+template <>
+inline bool ESPConfigImage::is<double>(const entry_t& entry) const {
+  return entry.type == 2;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::string>(const entry_t& entry) const {
+  return entry.type == 3;
+}
+
+template <>
+inline bool ESPConfigImage::is<const char*>(const entry_t& entry) const {
+  return entry.type == 3;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::vector<bool>>(const entry_t& entry) const {
+  return entry.type == 5;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::vector<int32_t>>(const entry_t& entry) const {
+  return entry.type == 6;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::vector<double>>(const entry_t& entry) const {
+  return entry.type == 7;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::vector<std::string>>(const entry_t& entry) const {
+  return entry.type == 8;
+}
+
+template <>
+inline bool ESPConfigImage::is<std::array<double, 2>>(const entry_t& entry) const {
+  return entry.type == 7 && entry.count == 2;
+}
+
+// ---- value ----
+
+template <typename T>
+inline T ESPConfigImage::value(const entry_t& entry) const {
+  return T{};
+}
+
+template <> bool ESPConfigImage::value(const entry_t& entry) const;
+template <> int32_t ESPConfigImage::value(const entry_t& entry) const;
+template <> double ESPConfigImage::value(const entry_t& entry) const;
+template <> std::string ESPConfigImage::value(const entry_t& entry) const;
+template <> const char* ESPConfigImage::value(const entry_t& entry) const;
+template <> std::array<double, 2> ESPConfigImage::value(const entry_t& entry) const;
+template <> std::vector<bool> ESPConfigImage::value(const entry_t& entry) const;
+template <> std::vector<int32_t> ESPConfigImage::value(const entry_t& entry) const;
+template <> std::vector<double> ESPConfigImage::value(const entry_t& entry) const;
+template <> std::vector<std::string> ESPConfigImage::value(const entry_t& entry) const;
+
+// ---- arrayView ----
+
+template <typename T>
+inline T ESPConfigImage::arrayView<T>::operator[](size_t index) const {
+  T val;
+  memcpy_P(&val, m_data + index * sizeof(T), sizeof(T));
+  return val;
+}
+
+template <>
+inline bool ESPConfigImage::arrayView<bool>::operator[](size_t index) const {
+  return pgm_read_byte(m_data + index) != 0;
+}
+
+template <>
+inline const char* ESPConfigImage::arrayView<const char*>::operator[](
+    size_t index) const {
+  uint32_t offset;
+  memcpy_P(&offset, m_data + index * sizeof(uint32_t), sizeof(uint32_t));
+  return (const char*)m_base + offset;
+}
+
+template <typename T>
+inline ESPConfigImage::arrayView<T> ESPConfigImage::array(
+    const entry_t& entry) const {
+  return {};
+}
+
+template <>
+inline ESPConfigImage::arrayView<bool> ESPConfigImage::array(
+    const entry_t& entry) const {
+  return is<std::vector<bool>>(entry) && resident(entry)
+    ? arrayView<bool>{m_data, m_data + entry.value, entry.count}
+    : arrayView<bool>{};
+}
+
+template <>
+inline ESPConfigImage::arrayView<int32_t> ESPConfigImage::array(
+    const entry_t& entry) const {
+  return is<std::vector<int32_t>>(entry) && resident(entry)
+    ? arrayView<int32_t>{m_data, m_data + entry.value, entry.count}
+    : arrayView<int32_t>{};
+}
+
+template <>
+inline ESPConfigImage::arrayView<double> ESPConfigImage::array(
+    const entry_t& entry) const {
+  return is<std::vector<double>>(entry) && resident(entry)
+    ? arrayView<double>{m_data, m_data + entry.value, entry.count}
+    : arrayView<double>{};
+}
+
+template <>
+inline ESPConfigImage::arrayView<const char*> ESPConfigImage::array(
+    const entry_t& entry) const {
+  return is<std::vector<std::string>>(entry)
+    ? arrayView<const char*>{m_data, m_data + entry.value, entry.count}
+    : arrayView<const char*>{};
+}
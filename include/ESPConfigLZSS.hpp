@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <memory>
+#include <new>
+#include <string>
+
+// A small window LZSS coder for the saved configuration.
+//
+// The compressed data starts with the magic byte, a version byte and the
+// uncompressed length as a little endian uint16. Each following flag byte
+// describes the next eight items from its lowest bit up, a set bit is a
+// literal byte and a clear bit a two byte match of (offset - 1) in the
+// upper 10 bits and (length - 3) in the lower 6 bits, copied from the
+// previous windowSize bytes of output.
+class ESPConfigLZSS {
+  public:
+    static constexpr uint8_t magic{0xEC};  // never the first byte of JSON
+    static constexpr uint8_t version{1};
+    static constexpr size_t headerSize{4};
+    static constexpr size_t windowSize{1024};
+    static constexpr size_t minMatch{3};
+    static constexpr size_t maxMatch{minMatch + 63};
+
+    static std::string compress(const std::string& data);
+
+    // A Stream returning the uncompressed data read from another Stream
+    class reader : public Stream {
+      public:
+        explicit reader(Stream& in) : m_in{in} {}
+
+        // false without memory for the window
+        explicit operator bool() const { return (bool)m_window; }
+        bool begin();
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t) override { return 0; }
+
+      private:
+        int next();
+
+        Stream& m_in;
+        // on the heap, so reading does not take 1 KiB of the 4 KiB loop stack
+        // of the ESP8266
+        std::unique_ptr<uint8_t[]> m_window{new (std::nothrow)
+                                                uint8_t[windowSize]};
+        size_t m_pos{0};         // total bytes produced
+        size_t m_length{0};      // uncompressed length
+        size_t m_matchFrom{0};   // window position of the current match
+        size_t m_matchLeft{0};   // bytes left in the current match
+        uint16_t m_flags{0};     // flag bits left, with a marker bit above
+        int m_peek{-1};
+    };
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#ifndef ESPCONFIG_PAGESIZE
+# define ESPCONFIG_PAGESIZE 256u
+#endif
+
+#ifndef ESPCONFIG_PAGES
+# define ESPCONFIG_PAGES 4u
+#endif
+
+constexpr auto m_pageSize{ESPCONFIG_PAGESIZE};
+constexpr auto m_pageCount{ESPCONFIG_PAGES};
+
+// Reads the bytes of an array kept in storage a page at a time, holding the
+// last m_pageCount pages used
+class ESPConfigPager {
+  public:
+    using reader_t =
+        std::function<bool(uint32_t offset, uint8_t* data, size_t size)>;
+
+    // where the elements of an array are read from, type is the index of the
+    // array in the Supported Value Types table
+    struct source_t {
+      reader_t reader;
+      uint8_t type;
+      size_t count;
+    };
+
+    ESPConfigPager(reader_t reader, size_t length)
+        : m_reader{std::move(reader)}, m_length{length} {}
+
+    bool read(uint32_t offset, void* data, size_t size);
+
+  private:
+    struct page_t {
+      uint32_t offset{UINT32_MAX};
+      uint32_t used{0};
+      uint8_t data[m_pageSize];
+    };
+
+    const page_t* page(uint32_t offset);
+
+    reader_t m_reader;
+    const size_t m_length;
+    std::array<page_t, m_pageCount> m_pages;
+    uint32_t m_clock{0};
+};
+
+// A view of a bool, int32_t or double array read on demand through a pager,
+// copies share the pages. The reader of a source decides what it holds, see
+// ESPConfig::pagedSource.
+template <typename T>
+class ESPConfigPagedArray {
+  public:
+    ESPConfigPagedArray() = default;
+    explicit ESPConfigPagedArray(const ESPConfigPager::source_t& source)
+        : m_pager{std::make_shared<ESPConfigPager>(
+              source.reader, source.count * sizeof(stored_t))},
+          m_count{source.count} {}
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    T operator[](size_t index) const {
+      stored_t val{};
+      if (index < m_count) {
+        m_pager->read(index * sizeof(stored_t), &val, sizeof(val));
+      }
+      return (T)val;
+    }
+
+  private:
+    // a bool is held as one byte
+    using stored_t = typename std::conditional<std::is_same<T, bool>::value,
+                                               uint8_t, T>::type;
+
+    std::shared_ptr<ESPConfigPager> m_pager;
+    size_t m_count{0};
+};
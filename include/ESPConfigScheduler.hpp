@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ESPConfig.hpp"
+
+#include <vector>
+
+// the quiet period after the last request before saving, in milliseconds
+#ifndef ESPCONFIG_SAVEQUIET
+# define ESPCONFIG_SAVEQUIET 2000u
+#endif
+
+// the longest a request waits while requests keep coming, in milliseconds
+#ifndef ESPCONFIG_SAVEMAXDELAY
+# define ESPCONFIG_SAVEMAXDELAY 30000u
+#endif
+
+// the saves allowed in any hour, 0 for no limit
+#ifndef ESPCONFIG_SAVESPERHOUR
+# define ESPCONFIG_SAVESPERHOUR 12u
+#endif
+
+// Turns many save requests into few writes, e.g.
+//
+//   ESPConfigScheduler saver{config};
+//   config.value("volume", 7);
+//   saver.requestSave();
+//
+//   void loop() { saver.handle(); }
+//
+// A save is made once no request came for the quiet period, or once the
+// first waiting request is maxDelay old, as long as the hourly budget allows
+// and the config changed since it was last read or saved.
+// flushNow() saves a waiting request at once whatever the budget, e.g. from
+// a brownout or shutdown handler.
+class ESPConfigScheduler {
+  public:
+    struct counters_t {
+      uint32_t requests;   // calls to requestSave()
+      uint32_t saves;      // saves made
+      uint32_t flushes;    // saves made by flushNow()
+      uint32_t throttled;  // saves held back by the hourly budget
+      uint32_t failed;     // saves the storage did not make
+    };
+
+    explicit ESPConfigScheduler(const ESPConfig& config,
+                                uint32_t quiet = ESPCONFIG_SAVEQUIET,
+                                uint32_t maxDelay = ESPCONFIG_SAVEMAXDELAY,
+                                uint16_t savesPerHour = ESPCONFIG_SAVESPERHOUR)
+        : m_config{config},
+          m_quiet{quiet},
+          m_maxDelay{maxDelay},
+          m_saveTimes(savesPerHour) {}
+
+    void requestSave();
+    void handle();
+    void flushNow();
+    bool pending() const { return m_pending; }
+    const counters_t& counters() const { return m_counters; }
+
+  private:
+    bool budgetLeft(uint32_t now) const;
+    bool save(uint32_t now);
+
+    const ESPConfig& m_config;
+    const uint32_t m_quiet;
+    const uint32_t m_maxDelay;
+    std::vector<uint32_t> m_saveTimes;  // the last saves, oldest at m_next
+    size_t m_next{0};
+    size_t m_saved{0};
+    bool m_pending{false};
+    bool m_throttled{false};
+    uint32_t m_first{0};
+    uint32_t m_last{0};
+    counters_t m_counters{};
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "ESPConfig.hpp"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// A compile time description of keys held in a plain struct, e.g.
+//
+//   struct mqtt_t { std::string host; int32_t port; bool tls; };
+//   constexpr auto mqttSchema{espConfigSchema(
+//       espConfigField("host", &mqtt_t::host, "localhost"),
+//       espConfigField("port", &mqtt_t::port, 1883),
+//       espConfigField("tls", &mqtt_t::tls, false))};
+//
+//   mqtt_t mqtt;
+//   config.bind(mqtt, mqttSchema);
+
+template <typename S, typename T, typename D>
+struct ESPConfigField {
+  const char* key;
+  T S::*member;
+  D defaultValue;
+};
+
+template <typename S, typename T, typename D>
+constexpr ESPConfigField<S, T, D> espConfigField(const char* key,
+                                                 T S::*member,
+                                                 D defaultValue) {
+  return {key, member, defaultValue};
+}
+
+// a field without a default is value initialized
+template <typename S, typename T>
+constexpr ESPConfigField<S, T, std::nullptr_t> espConfigField(const char* key,
+                                                              T S::*member) {
+  return {key, member, nullptr};
+}
+
+namespace espconfig_schema {
+
+// ---- read a JSON value into a struct member ----
+
+template <typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+readValue(T& member, JsonVariantConst value) {
+  if (!value.is<T>()) {
+    return false;
+  }
+  member = value.as<T>();
+  return true;
+}
+
+inline bool readValue(std::string& member, JsonVariantConst value) {
+  if (!value.is<const char*>()) {
+    return false;
+  }
+  member = value.as<const char*>();
+  return true;
+}
+
+template <size_t N>
+inline bool readValue(char (&member)[N], JsonVariantConst value) {
+  if (!value.is<const char*>()) {
+    return false;
+  }
+  strncpy(member, value.as<const char*>(), N - 1);
+  member[N - 1] = '\0';
+  return true;
+}
+
+template <typename T>
+inline bool readValue(std::vector<T>& member, JsonVariantConst value) {
+  if (!value.is<JsonArrayConst>()) {
+    return false;
+  }
+  std::vector<T> values(value.as<JsonArrayConst>().size());
+  auto index{0u};
+  for (auto val : value.as<JsonArrayConst>()) {
+    T element;
+    if (!readValue(element, val)) {
+      return false;
+    }
+    values[index++] = std::move(element);
+  }
+  member = std::move(values);
+  return true;
+}
+
+// ---- write a struct member into a JSON object ----
+
+template <typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value>::type
+writeValue(const T& member, JsonVariant json) {
+  json.set(member);
+}
+
+inline void writeValue(const std::string& member, JsonVariant json) {
+  json.set(member.c_str());
+}
+
+template <size_t N>
+inline void writeValue(const char (&member)[N], JsonVariant json) {
+  json.set((const char*)member);
+}
+
+template <typename T>
+inline void writeValue(const std::vector<T>& member, JsonVariant json) {
+  auto arr{json.to<JsonArray>()};
+  for (const auto& element : member) {
+    writeValue(element, arr.add());
+  }
+}
+
+// ---- assign a default ----
+
+template <typename T, typename D>
+inline void assign(T& member, const D& defaultValue) {
+  member = defaultValue;
+}
+
+template <typename T>
+inline void assign(T& member, std::nullptr_t) {
+  member = T{};
+}
+
+template <size_t N>
+inline void assign(char (&member)[N], std::nullptr_t) {
+  member[0] = '\0';
+}
+
+template <size_t N>
+inline void assign(char (&member)[N], const char* defaultValue) {
+  strncpy(member, defaultValue ? defaultValue : "", N - 1);
+  member[N - 1] = '\0';
+}
+
+}  // namespace espconfig_schema
+
+template <typename S, typename... F>
+class ESPConfigSchema {
+  public:
+    using struct_t = S;
+
+    constexpr explicit ESPConfigSchema(F... fields) : m_fields{fields...} {}
+
+    static constexpr size_t size() { return sizeof...(F); }
+
+    const char* key(size_t index) const {
+      const char* found{nullptr};
+      forEach([&found, &index](const auto& field) {
+        if (index-- == 0) {
+          found = field.key;
+        }
+        return found != nullptr;
+      });
+      return found;
+    }
+
+    void defaults(S& object) const {
+      forEach([&object](const auto& field) {
+        espconfig_schema::assign(object.*field.member, field.defaultValue);
+        return false;
+      });
+    }
+
+    bool readValue(S& object, const char* key, JsonVariantConst value) const {
+      return forEach([&object, key, value](const auto& field) {
+        return strcmp(field.key, key) == 0 &&
+               espconfig_schema::readValue(object.*field.member, value);
+      });
+    }
+
+    void writeJson(const S& object, JsonObject json) const {
+      forEach([&object, &json](const auto& field) {
+        espconfig_schema::writeValue(object.*field.member, json[field.key]);
+        return false;
+      });
+    }
+
+  private:
+    // call fn for each field until it returns true
+    template <typename Fn>
+    bool forEach(Fn&& fn) const {
+      return forEach(fn, std::index_sequence_for<F...>{});
+    }
+
+    template <typename Fn, size_t... I>
+    bool forEach(Fn& fn, std::index_sequence<I...>) const {
+      bool done{false};
+      (void)std::initializer_list<int>{
+          (done = done || fn(std::get<I>(m_fields)), 0)...};
+      return done;
+    }
+
+    const std::tuple<F...> m_fields;
+};
+
+template <typename S, typename... T, typename... D>
+constexpr ESPConfigSchema<S, ESPConfigField<S, T, D>...> espConfigSchema(
+    ESPConfigField<S, T, D>... fields) {
+  return ESPConfigSchema<S, ESPConfigField<S, T, D>...>{fields...};
+}
+
+// ---- bind ----
+
+template <typename S, typename Schema>
+class ESPConfigBinding : public ESPConfig::schemaBinding {
+  public:
+    ESPConfigBinding(S& object, const Schema& schema)
+        : m_object{object}, m_schema{schema} {
+      m_schema.defaults(m_object);
+    }
+
+    size_t size() const override { return m_schema.size(); }
+    const char* key(size_t index) const override { return m_schema.key(index); }
+
+    bool readValue(const char* key, JsonVariantConst value) override {
+      return m_schema.readValue(m_object, key, value);
+    }
+
+    void writeJson(JsonObject json) const override {
+      m_schema.writeJson(m_object, json);
+    }
+
+  private:
+    S& m_object;
+    const Schema m_schema;  // a copy, so a temporary schema may be bound
+};
+
+template <typename S, typename Schema>
+inline ESPConfig& ESPConfig::bind(S& object, const Schema& schema) {
+  static_assert(std::is_same<S, typename Schema::struct_t>::value,
+                "ESPConfig bind: the schema does not describe this struct");
+  return bind(std::unique_ptr<schemaBinding>{
+      new ESPConfigBinding<S, Schema>{object, schema}});
+}
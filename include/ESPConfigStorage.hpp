@@ -0,0 +1,190 @@
+#pragma once
+
+#include "ESPConfig.hpp"
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(ESP32)
+# include <Preferences.h>
+#endif
+
+// Where a config is read from and saved to. read() reads each storage of a
+// config in turn and save() writes the last one given, e.g.
+//
+//   ESPConfig config{std::unique_ptr<ESPConfigStorage>{
+//       new ESPConfigRecordStorage{"config"}}};
+//
+// A storage may list keys in read() with defer() and load each one with
+// readKey() the first time it is used, pages() lets ESPConfig::paged read the
+// elements of a deferred array without loading it.
+class ESPConfigStorage {
+  public:
+    virtual ~ESPConfigStorage() = default;
+    virtual void read(ESPConfig& config) = 0;
+    virtual void save(const ESPConfig& config) = 0;
+    virtual bool readKey(ESPConfig& config, const char* key) { return false; }
+    virtual bool pages(const char* key, ESPConfigPager::source_t& source) {
+      return false;
+    }
+    // read again by ESPConfig::read(jsonStr) before the string
+    virtual bool fromFiles() const { return false; }
+
+  protected:
+    // the parts of ESPConfig a storage works with
+    static void readJson(ESPConfig& config, JsonObjectConst json);
+    static void readValue(ESPConfig& config, const char* key,
+                          JsonVariantConst value);
+    static void readImage(ESPConfig& config, const ESPConfigImage& image,
+                          uint32_t resident = UINT32_MAX);
+    static void readPaged(ESPConfig& config, const char* key,
+                          const ESPConfigPager::source_t& source);
+    static DynamicJsonDocument toJSONObj(const ESPConfig& config);
+    static void writeDirty(const ESPConfig& config, JsonObject json,
+                           std::vector<std::string>& removed);
+    // call once the config is saved
+    static void clean(const ESPConfig& config) {
+      config.clean();
+      config.m_saved = true;
+    }
+  #if ESPCONFIG_STATS
+    static ESPConfig::stats_t& stats() { return ESPConfig::m_stats; }
+  #endif
+    void defer(ESPConfig& config, const char* key) { config.defer(key, this); }
+
+    // read JSON, or JSON compressed by save(), parse() does not count the
+    // overflows so it may run in a thread
+    static DeserializationError deserialize(DynamicJsonDocument& json,
+                                            Stream& stream);
+    static DeserializationError parse(DynamicJsonDocument& json,
+                                      Stream& stream);
+};
+
+// A config saved as one JSON document in the EEPROM area, or in a named
+// segment of it
+class ESPConfigEepromStorage : public ESPConfigStorage {
+  public:
+    ESPConfigEepromStorage(uint16_t offset = 0,
+                           uint16_t length = m_eepromSize)
+        : m_offset{offset}, m_length{length} {}
+    explicit ESPConfigEepromStorage(const ESPConfig::segment_t& segment);
+
+    void read(ESPConfig& config) override;
+    void save(const ESPConfig& config) override;
+
+  private:
+    static bool holdsConfig();
+
+    uint16_t m_offset;
+    uint16_t m_length;
+};
+
+// A config read from a list of JSON files, the first file overrides the
+// others and is the one written by save(). Up to parallel files are parsed at
+// once, each into its own document, and merged in the order of the list.
+// While arrays are left in the cache file it is kept open and the file system
+// mounted, until the next read() or the storage is destroyed.
+class ESPConfigFileStorage : public ESPConfigStorage {
+  public:
+    ESPConfigFileStorage(
+        const std::vector<const char*> configFileList,
+        ESPConfig::fileSystem_t fileSys,
+        ESPConfig::mountCallBack_t mountCB = [](ESPConfig::fileSystem_t) {},
+        ESPConfig::mountCallBack_t unmountCB = [](ESPConfig::fileSystem_t) {},
+        uint8_t parallel = ESPCONFIG_PARALLEL)
+        : m_fileSys{fileSys},
+          m_configFileList{configFileList},
+          m_mountCB{mountCB},
+          m_unmountCB{unmountCB},
+          m_parallel{parallel} {}
+  #if ESPCONFIG_CACHE
+    ~ESPConfigFileStorage() override;
+  #endif
+
+    void read(ESPConfig& config) override;
+    void save(const ESPConfig& config) override;
+  #if ESPCONFIG_CACHE
+    bool readKey(ESPConfig& config, const char* key) override;
+    bool pages(const char* key, ESPConfigPager::source_t& source) override;
+  #endif
+    bool fromFiles() const override { return true; }
+
+  private:
+    struct layer_t {
+      explicit layer_t(size_t size) : json{size} {}
+      DynamicJsonDocument json;
+      DeserializationError error{};
+      bool opened{false};
+    };
+
+    void readFiles(ESPConfig& config) const;
+    void parseFile(layer_t& layer, const char* fileName) const;
+    static bool parsed(const layer_t& layer, const char* fileName);
+    void unmount();
+  #if ESPCONFIG_CACHE
+    void closeCache();
+    uint32_t sourceSignature() const;
+    std::string cacheFileName() const;
+    bool readCache(ESPConfig& config, uint32_t signature);
+    void writeCache(ESPConfig& config, uint32_t signature,
+                    const ESPConfig& files);
+    void readCached(ESPConfig& config, const ESPConfigImage& image,
+                    uint32_t signature, uint32_t resident);
+  #endif
+
+    ESPConfig::fileSystem_t m_fileSys;
+    const std::vector<const char*> m_configFileList;
+    const ESPConfig::mountCallBack_t m_mountCB;
+    const ESPConfig::mountCallBack_t m_unmountCB;
+    const uint8_t m_parallel;
+  #if ESPCONFIG_CACHE
+    // the arrays left in the cache file, read through the open cache file
+    std::unordered_map<std::string, ESPConfigPager::source_t> m_paged;
+    fs::File m_cacheFile;
+    uint32_t m_cacheSignature{0};
+  #endif
+};
+
+// A config saved as one record per top level key, so save() writes only the
+// keys changed since the last read or save. The records are kept in the
+// Preferences namespace name on the ESP32, in the directory name of fileSys
+// when it is given, or in RAM otherwise. The name must not hold a '/'. With
+// lazy set read() only reads the list of keys, each value is read when the key
+// is first used.
+//
+// bool, int32_t and string values are typed records on the ESP32, every other
+// record holds the value as MessagePack.
+class ESPConfigRecordStorage : public ESPConfigStorage {
+  public:
+    ESPConfigRecordStorage(const char* name,
+                           ESPConfig::fileSystem_t fileSys = nullptr,
+                           const bool lazy = true);
+
+    void read(ESPConfig& config) override;
+    void save(const ESPConfig& config) override;
+    bool readKey(ESPConfig& config, const char* key) override;
+
+  private:
+    static bool validName(const std::string& name,
+                          ESPConfig::fileSystem_t fileSys);
+    static std::string recordName(const char* key);
+    std::string recordPath(const std::string& record) const;
+    bool begin(const bool readOnly);
+    void end();
+    bool readRecord(const std::string& record, DynamicJsonDocument& json);
+    bool writeRecord(const std::string& record, JsonVariantConst value);
+    void removeRecord(const std::string& record);
+
+    const std::string m_name;
+    ESPConfig::fileSystem_t m_fileSys;
+    const bool m_lazy;
+    const bool m_valid;  // neither read nor saved with an invalid name
+    std::set<std::string> m_index;  // the keys held in the records
+  #if defined(ESP32)
+    Preferences m_preferences;
+  #else
+    std::unordered_map<std::string, std::string> m_records;
+  #endif
+};
@@ -2,78 +2,228 @@
 
 #include "ESPConfig.hpp"
 
-// ---- is ----
+// ---- holds / get ----
 
 template <typename T>
-inline bool ESPConfig::is(const char* key) const {
-  return m_config.find(key) != m_config.end() &&
+inline bool ESPConfig::holds(const configValue_t* value) {
+  return value != nullptr &&
   #if __has_include(<variant>)
-    std::holds_alternative<T>(m_config.at(key));
+    std::holds_alternative<T>(*value);
   #else
-    m_config.at(key).type() == typeid(T);
+    value->type() == typeid(T);
   #endif
 }
 
+template <typename T>
+inline const T& ESPConfig::get(const configValue_t& value) {
+#if __has_include(<variant>)
+  return std::get<T>(value);
+#else
+  return linb::any_cast<const T&>(value);
+#endif
+}
+
+// ---- isValue / toValue ----
+
+template <typename T>
+inline bool ESPConfig::isValue(const configValue_t* value) {
+  return holds<T>(value);
+}
+
 template <>
-inline bool ESPConfig::is<std::array<double, 2>>(const char* key) const {
-  return m_config.find(key) != m_config.end() &&
-  #if __has_include(<variant>)
-    std::holds_alternative<std::vector<double>>(m_config.at(key)) &&
-  #else
-    m_config.at(key).type() == typeid(std::vector<double>) &&
-  #endif
-    value<std::vector<double>>(key).size() == 2;
+inline bool ESPConfig::isValue<std::array<double, 2>>(const configValue_t* value) {
+  return holds<std::vector<double>>(value) &&
+    get<std::vector<double>>(*value).size() == 2;
+}
+
+template <typename T>
+inline T ESPConfig::toValue(const configValue_t* value) {
+  return (isValue<T>(value)) ? get<T>(*value) : (T){};
+}
+
+template <>
+inline const char* ESPConfig::toValue(const configValue_t* value) {
+  return (isValue<std::string>(value))
+    ? get<std::string>(*value).c_str()
+    : "";
+}
+
+template <>
+inline std::array<double, 2> ESPConfig::toValue(const configValue_t* value) {
+  return (isValue<std::array<double, 2>>(value))
+    ? std::array<double, 2>{
+        get<std::vector<double>>(*value)[0],
+        get<std::vector<double>>(*value)[1],
+      }
+    : std::array<double, 2>{};
+}
+
+// ---- defaultValue ----
+
+template <typename T>
+inline T ESPConfig::defaultValue(const ESPConfigImage::entry_t& entry) const {
+  return m_defaults.value<T>(entry);
+}
+
+#if defined(ESP8266)
+// an image in flash cannot be read by the str functions, so a default string is
+// copied to RAM once and kept until the defaults change
+template <>
+inline const char* ESPConfig::defaultValue(
+    const ESPConfigImage::entry_t& entry) const {
+  if (!m_defaults.is<const char*>(entry)) {
+    return "";
+  }
+  auto copy{m_defaultStrings.emplace(entry.value, std::string{})};
+  if (copy.second) {
+    copy.first->second = m_defaults.value<std::string>(entry);
+  }
+  return copy.first->second.c_str();
+}
+#endif
+
+// ---- is ----
+
+template <typename T>
+inline bool ESPConfig::is(const char* key) const {
+  auto val{lookup(key)};
+  ESPConfigImage::entry_t entry;
+  return (val || !m_defaults.lookup(key, entry))
+    ? isValue<T>(val)
+    : m_defaults.is<T>(entry);
 }
 
 // ---- value setter ----
 
 template <typename T>
 inline ESPConfig& ESPConfig::value(const char* key, T value) {
-  m_config.insert_or_assign(key, (T)value);
-  return *this;
+  return store(key, std::move(value));
 }
 
 template <>
 inline ESPConfig& ESPConfig::value<const char*>(const char* key, const char* value) {
-  m_config.insert_or_assign(key, std::string{value});
-  return *this;
+  return store(key, std::string{value});
 }
 
 template <>
 inline ESPConfig& ESPConfig::value<std::array<double, 2>>(const char* key,
                                                           const std::array<double, 2> value) {
-  m_config.insert_or_assign(key, std::vector<double>{value[0], value[1]});
-  return *this;
+  return store(key, std::vector<double>{value[0], value[1]});
 }
 
 // ---- value getter ----
 
 template <typename T>
 inline T ESPConfig::value(const char* key) const {
-#if __has_include(<variant>)
-  return (is<T>(key)) ? std::get<T>(m_config.at(key)) : (T){};
-#else
-  return (is<T>(key)) ? linb::any_cast<T>(m_config.at(key)) : (T){};
-#endif
+  auto val{lookup(key)};
+  ESPConfigImage::entry_t entry;
+  return (val || !m_defaults.lookup(key, entry))
+    ? toValue<T>(val)
+    : defaultValue<T>(entry);
 }
 
+// ---- view ----
+
+template <typename T>
+inline ESPConfigImage::arrayView<T> ESPConfig::view(const char* key) const {
+  auto val{lookup(key)};
+  ESPConfigImage::entry_t entry;
+  if (val || !m_defaults.lookup(key, entry)) {
+    return (holds<std::vector<T>>(val))
+      ? ESPConfigImage::arrayView<T>{
+          nullptr, (const uint8_t*)get<std::vector<T>>(*val).data(),
+          get<std::vector<T>>(*val).size()}
+      : ESPConfigImage::arrayView<T>{};
+  }
+  return m_defaults.array<T>(entry);
+}
+
+// only the image can hold contiguous bool and string arrays
 template <>
-inline const char* ESPConfig::value(const char* key) const {
-  return (is<std::string>(key))
-  #if __has_include(<variant>)
-    ? std::get<std::string>(m_config.at(key)).c_str()
-  #else
-    ? linb::any_cast<std::string>(m_config.at(key)).c_str()
-  #endif
-    : "";
+inline ESPConfigImage::arrayView<bool> ESPConfig::view(const char* key) const {
+  ESPConfigImage::entry_t entry;
+  return (!lookup(key) && m_defaults.lookup(key, entry))
+    ? m_defaults.array<bool>(entry)
+    : ESPConfigImage::arrayView<bool>{};
 }
 
+#if defined(ESP8266)
+// the strings would point into flash, use value<std::vector<std::string>>
 template <>
-inline std::array<double, 2> ESPConfig::value(const char* key) const {
-  return (is<std::array<double, 2>>(key))
-    ? std::array<double, 2>{
-        value<std::vector<double>>(key)[0],
-        value<std::vector<double>>(key)[1],
-      }
-    : std::array<double, 2>{};
+ESPConfigImage::arrayView<const char*> ESPConfig::view(
+    const char* key) const = delete;
+#else
+template <>
+inline ESPConfigImage::arrayView<const char*> ESPConfig::view(
+    const char* key) const {
+  ESPConfigImage::entry_t entry;
+  return (!lookup(key) && m_defaults.lookup(key, entry))
+    ? m_defaults.array<const char*>(entry)
+    : ESPConfigImage::arrayView<const char*>{};
+}
+#endif
+
+// ---- paged ----
+
+// the order must match the configValue_t variant definition
+template <typename T>
+inline ESPConfigPagedArray<T> ESPConfig::paged(const char* key) const {
+  constexpr uint8_t type{std::is_same<T, bool>::value      ? 5
+                         : std::is_same<T, int32_t>::value ? 6
+                         : std::is_same<T, double>::value  ? 7
+                                                           : 0};
+  ESPConfigPager::source_t source;
+  return (pagedSource(key, source) && source.type == type)
+    ? ESPConfigPagedArray<T>{source}
+    : ESPConfigPagedArray<T>{};
+}
+
+// ---- valueView ----
+
+template <typename T>
+inline bool ESPConfig::valueView::is() const {
+  return holds<T>(&m_value);
+}
+
+template <typename T>
+inline const T& ESPConfig::valueView::as() const {
+  return get<T>(m_value);
+}
+
+// ---- resolvedPath ----
+
+template <typename T>
+inline bool ESPConfig::resolvedPath::is() const {
+  auto val{node()};
+  return (val || !m_isDefault)
+    ? isValue<T>(val)
+    : m_config.m_defaults.is<T>(m_default);
+}
+
+template <typename T>
+inline T ESPConfig::resolvedPath::value() const {
+  auto val{node()};
+  return (val || !m_isDefault)
+    ? toValue<T>(val)
+    : m_config.defaultValue<T>(m_default);
+}
+
+// ---- forEach ----
+
+template <typename F>
+inline void ESPConfig::forEach(F&& callBack) const {
+  loadPending();
+  for (const auto& kv : m_config) {
+    callBack(kv.first->c_str(), valueView{kv.second, indexOf(kv.second)});
+  }
+}
+
+template <typename T, typename F>
+inline void ESPConfig::forEach(F&& callBack) const {
+  loadPending();
+  for (const auto& kv : m_config) {
+    if (holds<T>(&kv.second)) {
+      callBack(kv.first->c_str(), get<T>(kv.second));
+    }
+  }
 }
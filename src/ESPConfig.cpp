@@ -2,130 +2,401 @@
 
 #include <algorithm>
 
-ESPConfig::ESPConfig()
-    : m_fileSys{nullptr},
-      m_configFileList{{}},
-      m_useEeprom{true},
-      m_mountCB{[](fileSystem_t fileSys) {}},
-      m_unmountCB{[](fileSystem_t fileSys) {}} {
+ESPConfig::revision_t ESPConfig::m_revision{0};
+#if ESPCONFIG_STATS
+ESPConfig::stats_t ESPConfig::m_stats{};
+#endif
+
+ESPConfig::ESPConfig() {
+  m_keys->users.insert(this);
+  m_storage.emplace_back(new ESPConfigEepromStorage{});
+  m_saveStorage = m_storage.back().get();
   read();
 }
 
 ESPConfig::ESPConfig(const char* configFileName, fileSystem_t fileSys,
                      const mountCallBack_t mountCB,
                      const mountCallBack_t unmountCB, const bool useEeprom)
-    : m_fileSys{fileSys},
-      m_configFileList{{configFileName}},
-      m_useEeprom{useEeprom},
-      m_mountCB{mountCB},
-      m_unmountCB{unmountCB} {
-  read();
-}
+    : ESPConfig{std::vector<const char*>{configFileName}, fileSys, mountCB,
+                unmountCB, useEeprom} {}
 
+// the EEPROM is read after the files so its values override theirs
 ESPConfig::ESPConfig(const std::vector<const char*> configFileList,
                      fileSystem_t fileSys, const mountCallBack_t mountCB,
-                     const mountCallBack_t unmountCB, const bool useEeprom)
-    : m_fileSys{fileSys},
-      m_configFileList{configFileList},
-      m_useEeprom{useEeprom},
-      m_mountCB{mountCB},
-      m_unmountCB{unmountCB} {
+                     const mountCallBack_t unmountCB, const bool useEeprom) {
+  m_keys->users.insert(this);
+  m_storage.emplace_back(
+      new ESPConfigFileStorage{configFileList, fileSys, mountCB, unmountCB});
+  m_storage.emplace_back(new ESPConfigEepromStorage{});
+  m_saveStorage = m_storage[useEeprom ? 1 : 0].get();
   read();
 }
 
-ESPConfig::ESPConfig(JsonObjectConst json)
-    : m_fileSys{nullptr}, m_configFileList{{}}, m_useEeprom{false} {
+// a config stored in its own slice of the EEPROM area
+ESPConfig::ESPConfig(const segment_t& segment)
+    : ESPConfig{std::unique_ptr<ESPConfigStorage>{
+          new ESPConfigEepromStorage{segment}}} {}
+
+ESPConfig::ESPConfig(std::unique_ptr<ESPConfigStorage> storage) {
+  m_keys->users.insert(this);
+  m_storage.push_back(std::move(storage));
+  m_saveStorage = m_storage.back().get();
+  read();
+}
+
+ESPConfig::ESPConfig(JsonObjectConst json) {
+  m_keys->users.insert(this);
+  readJson(json);
+}
+
+// a nested config sharing the key table of its parent
+ESPConfig::ESPConfig(JsonObjectConst json,
+                     const std::shared_ptr<keyTable_t>& keys)
+    : m_keys{keys} {
+  m_keys->users.insert(this);
   readJson(json);
+  m_dirty.clear();  // the key holding the child is dirty instead
+}
+
+// access an image in place, only the values set later are held in RAM
+ESPConfig::ESPConfig(const ESPConfigImage& image) {
+  m_keys->users.insert(this);
+  defaults(image);
 }
 
 ESPConfig::~ESPConfig() {
-  for (auto key : keys()) {
-    if (is<ESPConfigP_t>(key.c_str())) {
-      remove(key.c_str());
-    }
+  for (const auto& kv : m_config) {
+    release(kv.second);
   }
+  m_keys->users.erase(this);
 }
 
 ESPConfig& ESPConfig::remove(const char* key) {
-  if (is<ESPConfigP_t>(key)) {
-#if __has_include(<variant>)
-    delete std::get<ESPConfigP_t>(m_config.at(key));
-#else
-    delete linb::any_cast<ESPConfigP_t>(m_config.at(key));
-#endif
+  auto it{find(key)};
+  if (it != m_config.end()) {
+    m_dirty.insert(it->first);
+    release(it->second);
+    m_config.erase(it);
+    ++m_revision;
+  } else if (!m_pending.empty()) {
+    auto found{m_keys->find(key)};
+    if (found && m_pending.erase(found)) {
+      m_dirty.insert(found);
+    }
   }
-  m_config.erase(key);
   return *this;
 }
 
 ESPConfig& ESPConfig::reset() {
-  std::for_each(keys().begin(), keys().end(),
-                [this](const std::string& key) { remove(key.c_str()); });
+  for (const auto& kv : m_config) {
+    m_dirty.insert(kv.first);
+    release(kv.second);
+  }
+  for (const auto& kv : m_pending) {
+    m_dirty.insert(kv.first);
+  }
+  m_config.clear();
+  m_pending.clear();
+  ++m_revision;
   return *this;
 }
 
+ESPConfig& ESPConfig::store(const char* key, configValue_t value) {
+  auto stored{m_config.insert_or_assign(intern(key), std::move(value))};
+  m_dirty.insert(stored.first->first);
+#if ESPCONFIG_STATS
+  if (indexOf(stored.first->second) >= 3) {
+    ++m_stats.allocations;  // a string, a nested config or a vector
+  }
+#endif
+  if (stored.second) {
+    ++m_revision;  // a new key may complete a resolved path
+    m_pending.erase(stored.first->first);  // set before it was loaded
+  }
+  return *this;
+}
+
+const std::string* ESPConfig::keyTable_t::find(std::string_view key) const {
+  auto found{keys.find(key)};
+  return found != keys.end() ? &found->second : nullptr;
+}
+
+// a new node is inserted keyed by the view passed, then keyed again by a view
+// of the string it holds
+const std::string* ESPConfig::keyTable_t::intern(std::string_view key) {
+  auto found{keys.find(key)};
+  if (found == keys.end()) {
+    auto node{keys.extract(keys.emplace(key, std::string{key}).first)};
+    node.key() = node.mapped();
+    found = keys.insert(std::move(node)).position;
+  }
+  return &found->second;
+}
+
+const std::string* ESPConfig::intern(const char* key) {
+  return m_keys->intern(key);
+}
+
+ESPConfig::config_t::iterator ESPConfig::find(const char* key) {
+  auto found{m_keys->find(key)};
+  return found ? m_config.find(found) : m_config.end();
+}
+
+ESPConfig::config_t::const_iterator ESPConfig::find(const char* key,
+                                                    size_t keyLen) const {
+  auto found{m_keys->find({key, keyLen})};
+  return found ? m_config.find(found) : m_config.end();
+}
+
 const std::vector<std::string> ESPConfig::keys() const {
   std::vector<std::string> key{};
   key.reserve(m_config.size());
-  std::for_each(m_config.begin(), m_config.end(),
-                [&key](const std::pair<std::string, configValue_t>& c) {
-                  key.emplace_back(c.first.c_str());
-                });
+  forEach([&key](const char* k, const valueView&) { key.emplace_back(k); });
   return key;
 }
 
+size_t ESPConfig::indexOf(const configValue_t& value) const {
+#if __has_include(<variant>)
+  return value.index();
+#else
+  return std::distance(
+      anyIndex.begin(), std::find(anyIndex.begin(), anyIndex.end(),
+                                  std::type_index(value.type())));
+#endif
+}
+
+// delete the nested configs owned by a value
+void ESPConfig::release(const configValue_t& value) const {
+  if (holds<ESPConfigP_t>(&value)) {
+    delete get<ESPConfigP_t>(value);
+    ++m_revision;
+    return;
+  }
+  if (holds<std::vector<ESPConfigP_t>>(&value)) {
+    for (auto child : get<std::vector<ESPConfigP_t>>(value)) {
+      delete child;
+    }
+    ++m_revision;
+  }
+}
+
+const ESPConfig::configValue_t* ESPConfig::lookup(const char* path) const {
+  auto value{walk(path)};
+#if ESPCONFIG_STATS
+  ++m_stats.lookups;
+  ++(value ? m_stats.hits : m_stats.misses);
+#endif
+  return value;
+}
+
+// find a key, or walk a path such as "mqtt.tls.caFile" or "sensors[3].gain"
+// through the nested configs, a key containing '.' or '[' is matched first.
+// An index selects an element of an array of objects and is followed by a
+// key, so a path never ends with an index or holds two in a row.
+const ESPConfig::configValue_t* ESPConfig::walk(const char* path) const {
+  auto found{find(path, strlen(path))};
+  if (found == m_config.end() && loadPending(path, strlen(path))) {
+    found = find(path, strlen(path));
+  }
+  if (found != m_config.end()) {
+    return &found->second;
+  }
+  if (!strpbrk(path, ".[")) {
+    return nullptr;
+  }
+
+  auto node{this};
+  auto start{path};
+  while (true) {
+    auto len{strcspn(path, ".[")};
+    found = node->find(path, len);
+    if (found == node->m_config.end() && node->loadPending(path, len)) {
+      found = node->find(path, len);
+    }
+    if (found == node->m_config.end()) {
+      return nullptr;
+    }
+    path += len;
+
+    switch (*path) {
+      case '\0':
+        return &found->second;
+      case '.':
+        if (!holds<ESPConfigP_t>(&found->second)) {
+          return nullptr;
+        }
+        node = get<ESPConfigP_t>(found->second);
+        ++path;
+        break;
+      case '[': {
+        char* end{nullptr};
+        auto index{isdigit((unsigned char)path[1]) ? strtoul(path + 1, &end, 10)
+                                                   : 0};
+        if (!end || *end != ']' || end[1] != '.') {
+          Serial.printf_P(PSTR("ESPConfig path error: '%s' is not a key, an "
+                               "index must be followed by a key as in "
+                               "\"sensors[3].gain\"\n"),
+                          start);
+          return nullptr;
+        }
+        if (!holds<std::vector<ESPConfigP_t>>(&found->second) ||
+            index >= get<std::vector<ESPConfigP_t>>(found->second).size()) {
+          return nullptr;
+        }
+        node = get<std::vector<ESPConfigP_t>>(found->second)[index];
+        path = end + 2;
+        break;
+      }
+    }
+  }
+}
+
+ESPConfig::resolvedPath ESPConfig::resolve(const char* path) const {
+  return resolvedPath{*this, path};
+}
+
+const ESPConfig::configValue_t* ESPConfig::resolvedPath::node() const {
+  uint32_t revision{ESPConfig::m_revision};
+  if (m_revision != revision) {
+    m_node = m_config.lookup(m_path.c_str());
+    m_isDefault =
+        !m_node && m_config.m_defaults.lookup(m_path.c_str(), m_default);
+    m_revision = revision;
+  }
+  return m_node;
+}
+
 ESPConfig& ESPConfig::read() {
-  read("");
+#if ESPCONFIG_STATS
+  auto start{micros()};
+#endif
+  for (const auto& storage : m_storage) {
+    storage->read(*this);
+  }
+#if ESPCONFIG_STATS
+  ++m_stats.reads;
+  m_stats.readMicros += micros() - start;
+#endif
+  return *this;
+}
 
-  DynamicJsonDocument json{m_jsonDocSize};
-  EEPROM.begin(m_eepromSize);
-  EepromStream eepromStream(0, m_eepromSize);
-  auto error{deserializeJson(json, eepromStream)};
-  eepromStream.flush();
-  EEPROM.end();
+// an RFC 7386 merge patch turning base into this config
+std::string ESPConfig::diff(const ESPConfig& base, saveFormat format) const {
+  auto target{toJSONObj()};
+  auto source{base.toJSONObj()};
+  DynamicJsonDocument patch{m_jsonDocSize};
+  diffJson(source.as<JsonObjectConst>(), target.as<JsonObjectConst>(),
+           patch.to<JsonObject>());
+#if ESPCONFIG_STATS
+  m_stats.overflows += patch.overflowed();
+#endif
+
+  // a patch missing changes would be applied as if it were complete
+  std::string output;
+  if (target.overflowed() || source.overflowed() || patch.overflowed()) {
+    Serial.printf_P(PSTR("ESPConfig diff error: the configurations or their "
+                         "differences do not fit in ESPCONFIG_JSONDOCSIZE\n"));
+    return output;
+  }
+  switch (format) {
+    case saveFormat::minified:
+      serializeJson(patch, output);
+      break;
+    case saveFormat::pretty:
+      serializeJsonPretty(patch, output);
+      break;
+    case saveFormat::msgPack:
+      serializeMsgPack(patch, output);
+      break;
+    default:
+      break;
+  }
+  return output;
+}
 
-  if (!error && json[ESPCONFIG_SAVEDKEY].as<bool>()) {
-    readJson(json.as<JsonObject>());
+void ESPConfig::diffJson(JsonObjectConst source, JsonObjectConst target,
+                         JsonObject patch) {
+  for (auto kv : source) {
+    if (target[kv.key().c_str()].isNull()) {
+      patch[(char*)kv.key().c_str()] = nullptr;
+    }
   }
 
+  for (auto kv : target) {
+    auto key{(char*)kv.key().c_str()};
+    auto from{source[key]};
+    if (from == kv.value()) {
+      continue;
+    }
+    if (from.is<JsonObjectConst>() && kv.value().is<JsonObjectConst>()) {
+      diffJson(from.as<JsonObjectConst>(), kv.value().as<JsonObjectConst>(),
+               patch.createNestedObject(key));
+      continue;
+    }
+    patch[key] = kv.value();
+  }
+}
+
+ESPConfig& ESPConfig::applyPatch(const char* patch) {
+  return applyPatch(patch, strlen(patch));
+}
+
+ESPConfig& ESPConfig::applyPatch(const char* patch, size_t patchLen) {
+  DynamicJsonDocument json{m_jsonDocSize};
+  auto error{deserializeJson(json, patch, patchLen)};
+#if ESPCONFIG_STATS
+  m_stats.overflows += error == DeserializationError::NoMemory;
+#endif
+  if (error || !json.is<JsonObject>()) {
+    Serial.printf_P(PSTR("ESPConfig patch error: the patch is not a JSON "
+                         "object\n"));
+    return *this;
+  }
+  applyJson(json.as<JsonObjectConst>());
   return *this;
 }
 
+void ESPConfig::applyJson(JsonObjectConst patch) {
+  for (auto kv : patch) {
+    auto key{kv.key().c_str()};
+    if (kv.value().isNull()) {
+      remove(key);
+      continue;
+    }
+
+    if (kv.value().is<JsonObjectConst>()) {
+      auto found{find(key)};
+      if (found == m_config.end() || !holds<ESPConfigP_t>(&found->second)) {
+        replace(key, new ESPConfig{JsonObjectConst{}, m_keys});
+        found = find(key);
+      }
+      get<ESPConfigP_t>(found->second)
+          ->applyJson(kv.value().as<JsonObjectConst>());
+      continue;
+    }
+
+    readValue(key, kv.value());
+  }
+}
+
 ESPConfig& ESPConfig::read(const char* jsonStr) {
   return read(jsonStr, strlen(jsonStr));
 }
 
+// the configuration files are read again first, so the string overrides
+// their values
 ESPConfig& ESPConfig::read(const char* jsonStr, size_t jsonStrLen) {
-  DynamicJsonDocument json{m_jsonDocSize};
-  // read configuration from FS json
-  if (m_fileSys) {
-    m_mountCB(m_fileSys);
-    std::for_each(
-        m_configFileList.rbegin(), m_configFileList.rend(),
-        [&json, this](const char* fileName) {
-          auto configFile = m_fileSys->open(fileName, "r");
-          if (configFile) {
-            DeserializationError error = deserializeJson(json, configFile);
-            configFile.close();
-            if (error) {
-              Serial.printf_P(PSTR("ESPConfig read error: config file "
-                                   "serializeJson() failed: %s\n"),
-                              error.c_str());
-              return;
-            }
-          } else {
-            Serial.printf_P(PSTR("ESPConfig read warning: unable to open "
-                                 "config file '%s' for read\n"),
-                            fileName);
-            return;
-          }
-          readJson(json.as<JsonObject>());
-        });
-    m_unmountCB(m_fileSys);
+  for (const auto& storage : m_storage) {
+    if (storage->fromFiles()) {
+      storage->read(*this);
+    }
   }
-
   if (jsonStrLen != 0) {
+    DynamicJsonDocument json{m_jsonDocSize};
     auto error{deserializeJson(json, jsonStr, jsonStrLen)};
+#if ESPCONFIG_STATS
+    m_stats.overflows += error == DeserializationError::NoMemory;
+#endif
     if (!error) {
       readJson(json.as<JsonObject>());
     }
@@ -134,85 +405,273 @@ ESPConfig& ESPConfig::read(const char* jsonStr, size_t jsonStrLen) {
   return *this;
 }
 
-void ESPConfig::readJson(JsonObjectConst json) {
-  for (auto kv : json) {
-    if (kv.value().is<bool>()) {
-      value(kv.key().c_str(), kv.value().as<bool>());
-      continue;
+// arrays with their data at or after resident are left to the storage
+void ESPConfig::readImage(const ESPConfigImage& image, uint32_t node,
+                          uint32_t resident) {
+  image.forEach(node, [&image, resident, this](
+                          const ESPConfigImage::entry_t& entry) {
+    if (entry.type >= 5 && entry.type <= 7 && entry.value >= resident) {
+      return;
     }
+    auto key{image.key(entry)};
 
-    if (kv.value().is<int32_t>()) {
-      value(kv.key().c_str(), kv.value().as<int32_t>());
-      continue;
+    // the order must match the configValue_t variant definition
+    switch (entry.type) {
+      case 0:  // bool
+        replace(key.c_str(), image.value<bool>(entry));
+        break;
+      case 1:  // int32_t
+        replace(key.c_str(), image.value<int32_t>(entry));
+        break;
+      case 2:  // double
+        replace(key.c_str(), image.value<double>(entry));
+        break;
+      case 3:  // std::string
+        replace(key.c_str(), image.value<std::string>(entry));
+        break;
+      case 4: {  // ESPConfig_t
+        auto child{new ESPConfig{JsonObjectConst{}, m_keys}};
+        child->readImage(image, entry.value);
+        child->m_dirty.clear();
+        replace(key.c_str(), child);
+        break;
+      }
+      case 5:  // std::vector<bool>
+        replace(key.c_str(), image.value<std::vector<bool>>(entry));
+        break;
+      case 6:  // std::vector<int32_t>
+        replace(key.c_str(), image.value<std::vector<int32_t>>(entry));
+        break;
+      case 7:  // std::vector<double>
+        replace(key.c_str(), image.value<std::vector<double>>(entry));
+        break;
+      case 8:  // std::vector<std::string>
+        replace(key.c_str(), image.value<std::vector<std::string>>(entry));
+        break;
+      case 9: {  // std::vector<ESPConfig_t>
+        std::vector<ESPConfigP_t> children;
+        children.reserve(entry.count);
+        for (auto i{0u}; i < entry.count; i++) {
+          children.push_back(new ESPConfig{JsonObjectConst{}, m_keys});
+          children.back()->readImage(image, image.node(entry, i));
+          children.back()->m_dirty.clear();
+        }
+        replace(key.c_str(), children);
+        break;
+      }
+      default:
+        break;
     }
+  });
+}
 
-    if (kv.value().is<double>()) {
-      value(kv.key().c_str(), kv.value().as<double>());
-      continue;
-    }
+namespace {
+template <typename T>
+std::vector<T> readArray(const ESPConfigPager::source_t& source) {
+  ESPConfigPagedArray<T> arr{source};
+  std::vector<T> values;
+  values.reserve(arr.size());
+  for (auto i{0u}; i < arr.size(); i++) {
+    values.push_back(arr[i]);
+  }
+  return values;
+}
 
-    if (kv.value().is<const char*>()) {
-      value(kv.key().c_str(), kv.value().as<const char*>());
-      continue;
-    }
+template <typename T>
+void writeArray(JsonArray json, const ESPConfigPager::source_t& source) {
+  ESPConfigPagedArray<T> arr{source};
+  for (auto i{0u}; i < arr.size(); i++) {
+    json.add(arr[i]);
+  }
+}
+}  // namespace
 
-    if (kv.value().is<JsonObjectConst>()) {
-      value(kv.key().c_str(), new ESPConfig{kv.value().as<JsonObjectConst>()});
-      continue;
+// where the elements of an array held by a storage, in RAM, or in the
+// defaults image are read from
+bool ESPConfig::pagedSource(const char* key,
+                            ESPConfigPager::source_t& source) const {
+  auto name{m_keys->find(key)};
+  if (name) {
+    auto pending{m_pending.find(name)};
+    if (pending != m_pending.end()) {
+      return pending->second->pages(key, source);
     }
+  }
 
-    if (kv.value().is<JsonArrayConst>() &&
-        kv.value().as<JsonArrayConst>().size() != 0) {
-      auto arr{kv.value().as<JsonArrayConst>()};
+  // an array in RAM is looked up again for every page read, so a paged array
+  // never reads freed memory and reads nothing once the value was removed or
+  // replaced by one of another type or size
+  auto heldCount{[](const configValue_t* value) -> size_t {
+    return holds<std::vector<bool>>(value)
+             ? get<std::vector<bool>>(*value).size()
+           : holds<std::vector<int32_t>>(value)
+             ? get<std::vector<int32_t>>(*value).size()
+           : holds<std::vector<double>>(value)
+             ? get<std::vector<double>>(*value).size()
+             : 0;
+  }};
+  auto val{lookup(key)};
+  auto count{heldCount(val)};
+  if (count != 0) {
+    auto config{this};
+    std::string path{key};
+    auto type{(uint8_t)indexOf(*val)};
+    source = {[config, path, type, count, heldCount](
+                  uint32_t offset, uint8_t* out, size_t size) {
+                auto held{config->lookup(path.c_str())};
+                if (!held || config->indexOf(*held) != type ||
+                    heldCount(held) != count) {
+                  return false;
+                }
+                if (type == 5) {
+                  const auto& values{get<std::vector<bool>>(*held)};
+                  for (auto i{0u}; i < size; i++) {
+                    out[i] = values[offset + i];
+                  }
+                  return true;
+                }
+                auto data{type == 6
+                              ? (const uint8_t*)get<std::vector<int32_t>>(*held)
+                                    .data()
+                              : (const uint8_t*)get<std::vector<double>>(*held)
+                                    .data()};
+                memcpy(out, data + offset, size);
+                return true;
+              },
+              type, count};
+    return true;
+  }
 
-      if (arr[0].is<bool>()) {
-        value(kv.key().c_str(), std::vector<bool>{});
-        value<std::vector<bool>>(kv.key().c_str()).reserve(arr.size());
-        for (auto val : arr) {
-          value<std::vector<bool>>(kv.key().c_str()).push_back(val.as<bool>());
-        }
-        continue;
+  ESPConfigImage::entry_t entry;
+  if (!val && m_defaults.lookup(key, entry) && entry.type >= 5 &&
+      entry.type <= 7) {
+    auto image{m_defaults};
+    source = {[image, entry](uint32_t offset, uint8_t* out, size_t size) {
+                memcpy_P(out, image.data() + entry.value + offset, size);
+                return true;
+              },
+              entry.type, entry.count};
+    return true;
+  }
+  return false;
+}
+
+void ESPConfig::readPaged(const char* key,
+                          const ESPConfigPager::source_t& source) {
+  // the order must match the configValue_t variant definition
+  switch (source.type) {
+    case 5:  // std::vector<bool>
+      replace(key, readArray<bool>(source));
+      break;
+    case 6:  // std::vector<int32_t>
+      replace(key, readArray<int32_t>(source));
+      break;
+    case 7:  // std::vector<double>
+      replace(key, readArray<double>(source));
+      break;
+    default:
+      break;
+  }
+}
+
+void ESPConfig::readJson(JsonObjectConst json) {
+  for (auto kv : json) {
+    readValue(kv.key().c_str(), kv.value());
+  }
+}
+
+// replace a value, deleting the nested configs it owned
+template <typename T>
+void ESPConfig::replace(const char* key, T val) {
+  auto found{find(key)};
+  if (found != m_config.end()) {
+    release(found->second);
+  }
+  value(key, std::move(val));
+}
+
+void ESPConfig::readValue(const char* key, JsonVariantConst val) {
+  if (m_binding && m_binding->readValue(key, val)) {
+    return;
+  }
+
+  if (val.is<bool>()) {
+    replace(key, val.as<bool>());
+    return;
+  }
+
+  if (val.is<int32_t>()) {
+    replace(key, val.as<int32_t>());
+    return;
+  }
+
+  if (val.is<double>()) {
+    replace(key, val.as<double>());
+    return;
+  }
+
+  if (val.is<const char*>()) {
+    replace(key, val.as<const char*>());
+    return;
+  }
+
+  if (val.is<JsonObjectConst>()) {
+    replace(key, new ESPConfig{val.as<JsonObjectConst>(), m_keys});
+    return;
+  }
+
+  if (val.is<JsonArrayConst>() && val.as<JsonArrayConst>().size() != 0) {
+    auto arr{val.as<JsonArrayConst>()};
+
+    if (arr[0].is<bool>()) {
+      std::vector<bool> values{};
+      values.reserve(arr.size());
+      for (auto elem : arr) {
+        values.push_back(elem.as<bool>());
       }
+      replace(key, std::move(values));
+      return;
+    }
 
-      if (arr[0].is<int32_t>()) {
-        value(kv.key().c_str(), std::vector<int32_t>{});
-        value<std::vector<int32_t>>(kv.key().c_str()).reserve(arr.size());
-        for (auto val : arr) {
-          value<std::vector<int32_t>>(kv.key().c_str())
-              .push_back(val.as<int32_t>());
-        }
-        continue;
+    if (arr[0].is<int32_t>()) {
+      std::vector<int32_t> values{};
+      values.reserve(arr.size());
+      for (auto elem : arr) {
+        values.push_back(elem.as<int32_t>());
       }
+      replace(key, std::move(values));
+      return;
+    }
 
-      if (arr[0].is<double>()) {
-        value(kv.key().c_str(), std::vector<double>{});
-        value<std::vector<double>>(kv.key().c_str()).reserve(arr.size());
-        for (auto val : arr) {
-          value<std::vector<double>>(kv.key().c_str())
-              .push_back(val.as<double>());
-        }
-        continue;
+    if (arr[0].is<double>()) {
+      std::vector<double> values{};
+      values.reserve(arr.size());
+      for (auto elem : arr) {
+        values.push_back(elem.as<double>());
       }
+      replace(key, std::move(values));
+      return;
+    }
 
-      if (arr[0].is<const char*>()) {
-        value(kv.key().c_str(), std::vector<std::string>{});
-        value<std::vector<std::string>>(kv.key().c_str()).reserve(arr.size());
-        for (auto val : arr) {
-          value<std::vector<std::string>>(kv.key().c_str())
-              .push_back(val.as<const char*>());
-        }
-        continue;
+    if (arr[0].is<const char*>()) {
+      std::vector<std::string> values{};
+      values.reserve(arr.size());
+      for (auto elem : arr) {
+        values.emplace_back(elem.is<const char*>() ? elem.as<const char*>()
+                                                   : "");
       }
+      replace(key, std::move(values));
+      return;
+    }
 
-      if (arr[0].is<JsonObjectConst>()) {
-        value(kv.key().c_str(), std::vector<ESPConfigP_t>{});
-        value<std::vector<ESPConfigP_t>>(kv.key().c_str()).reserve(arr.size());
-        for (auto val : arr) {
-          value<std::vector<ESPConfigP_t>>(kv.key().c_str())
-              .push_back(new ESPConfig{val.as<JsonObjectConst>()});
-        }
-        continue;
+    if (arr[0].is<JsonObjectConst>()) {
+      std::vector<ESPConfigP_t> values{};
+      values.reserve(arr.size());
+      for (auto elem : arr) {
+        values.push_back(new ESPConfig{elem.as<JsonObjectConst>(), m_keys});
       }
+      replace(key, std::move(values));
+      return;
     }
   }
 }
@@ -240,129 +699,585 @@ std::string ESPConfig::toJSON(ESPConfig::saveFormat format) const {
 DynamicJsonDocument ESPConfig::toJSONObj() const {
   DynamicJsonDocument json{m_jsonDocSize};
 
-  json[ESPCONFIG_SAVEDKEY] = true;
+  auto obj{json.to<JsonObject>()};
+  obj[ESPCONFIG_SAVEDKEY] = true;
+  if (m_binding) {
+    m_binding->writeJson(obj);
+  }
+  writeJson(obj);
+#if ESPCONFIG_STATS
+  m_stats.overflows += json.overflowed();
+#endif
 
-  for (const auto& keyStr : keys()) {
-    auto key{(char*)keyStr.c_str()};  // remove the const to force ArdunioJson
-                                      // to copy the key string into the object
-#if __has_include(<variant>)
-    auto index{m_config.at(key).index()};
+  return json;
+}
+
+// with ESPCONFIG_SORTKEYS the keys are written in strcmp order, as in an
+// image, at the cost of a sorted copy of the entries of each config
+// the arrays left in a storage are written a page at a time, without loading
+// them into the config
+void ESPConfig::writeJson(JsonObject json) const {
+  auto paged{pagedPending()};
+#if ESPCONFIG_SORTKEYS
+  std::vector<std::pair<const std::string*, const configValue_t*>> sorted;
+  sorted.reserve(m_config.size() + paged.size());
+  for (const auto& kv : m_config) {
+    sorted.emplace_back(kv.first, &kv.second);
+  }
+  for (const auto& kv : paged) {
+    sorted.emplace_back(kv.first, nullptr);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<const std::string*, const configValue_t*>& a,
+               const std::pair<const std::string*, const configValue_t*>& b) {
+              return *a.first < *b.first;
+            });
+  for (const auto& kv : sorted) {
+    if (kv.second) {
+      writeValue(json, kv.first->c_str(),
+                 valueView{*kv.second, indexOf(*kv.second)});
+      continue;
+    }
+    auto source{std::find_if(
+        paged.begin(), paged.end(),
+        [&kv](const std::pair<const std::string*, ESPConfigPager::source_t>&
+                  p) { return p.first == kv.first; })};
+    writePaged(json, kv.first->c_str(), source->second);
+  }
 #else
-    auto index{std::distance(
-        anyIndex.begin(), std::find(anyIndex.begin(), anyIndex.end(),
-                                    std::type_index(m_config.at(key).type())))};
+  for (const auto& kv : m_config) {
+    writeValue(json, kv.first->c_str(),
+               valueView{kv.second, indexOf(kv.second)});
+  }
+  for (const auto& kv : paged) {
+    writePaged(json, kv.first->c_str(), kv.second);
+  }
 #endif
+}
 
-    // the order must match the configValue_t variant definition
-    switch (index) {
-      case 0:  // bool
-        json[key] = value<bool>(key);
-        break;
-      case 1:  // int32_t
-        json[key] = value<int32_t>(key);
-        break;
-      case 2:  // double
-        json[key] = value<double>(key);
-        break;
-      case 3:  // std::string
-        json[key] = value<const char*>(key);
-        break;
-      case 4:  // ESPConfig_t
-        json[key] = value<ESPConfigP_t>(key)->toJSON().c_str();
-        break;
-      default: {
-        auto arr{json.createNestedArray(key)};
-        switch (index) {
-          case 5:  // std::vector<bool>
-            std::for_each(value<std::vector<bool>>(key).begin(),
-                          value<std::vector<bool>>(key).end(),
-                          [&arr](const bool val) { arr.add(val); });
-            break;
-          case 6:  // std::vector<int32_t>
-            std::for_each(value<std::vector<int32_t>>(key).begin(),
-                          value<std::vector<int32_t>>(key).end(),
-                          [&arr](const int32_t val) { arr.add(val); });
-            break;
-          case 7:  // std::vector<double>
-            std::for_each(value<std::vector<double>>(key).begin(),
-                          value<std::vector<double>>(key).end(),
-                          [&arr](const double val) { arr.add(val); });
-            break;
-          case 8:  // std::vector<std::string>
-            std::for_each(
-                value<std::vector<std::string>>(key).begin(),
-                value<std::vector<std::string>>(key).end(),
-                [&arr](const std::string& val) { arr.add(val.c_str()); });
-            break;
-          case 9:  // std::vector<ESPConfig_t>
-            std::for_each(value<std::vector<ESPConfigP_t>>(key).begin(),
-                          value<std::vector<ESPConfigP_t>>(key).end(),
-                          [&arr](const ESPConfigP_t val) {
-                            arr.add(val->toJSON().c_str());
-                          });
-            break;
-          default:
-            break;
-        }
-        break;
+void ESPConfig::writePaged(JsonObject json, const char* key,
+                           const ESPConfigPager::source_t& source) {
+  auto arr{json.createNestedArray((char*)key)};
+  // the order must match the configValue_t variant definition
+  switch (source.type) {
+    case 5:  // std::vector<bool>
+      writeArray<bool>(arr, source);
+      break;
+    case 6:  // std::vector<int32_t>
+      writeArray<int32_t>(arr, source);
+      break;
+    case 7:  // std::vector<double>
+      writeArray<double>(arr, source);
+      break;
+    default:
+      break;
+  }
+}
+
+void ESPConfig::writeValue(JsonObject json, const char* k,
+                           const valueView& val) {
+  auto key{(char*)k};  // remove the const to force ArdunioJson
+                       // to copy the key string into the object
+
+  // the order must match the configValue_t variant definition
+  switch (val.index()) {
+    case 0:  // bool
+      json[key] = val.as<bool>();
+      break;
+    case 1:  // int32_t
+      json[key] = val.as<int32_t>();
+      break;
+    case 2:  // double
+      json[key] = val.as<double>();
+      break;
+    case 3:  // std::string
+      json[key] = val.as<std::string>().c_str();
+      break;
+    case 4:  // ESPConfig_t
+      val.as<ESPConfigP_t>()->writeJson(json.createNestedObject(key));
+      break;
+    default: {
+      auto arr{json.createNestedArray(key)};
+      switch (val.index()) {
+        case 5:  // std::vector<bool>
+          for (const bool v : val.as<std::vector<bool>>()) {
+            arr.add(v);
+          }
+          break;
+        case 6:  // std::vector<int32_t>
+          for (const auto v : val.as<std::vector<int32_t>>()) {
+            arr.add(v);
+          }
+          break;
+        case 7:  // std::vector<double>
+          for (const auto v : val.as<std::vector<double>>()) {
+            arr.add(v);
+          }
+          break;
+        case 8:  // std::vector<std::string>
+          for (const auto& v : val.as<std::vector<std::string>>()) {
+            arr.add(v.c_str());
+          }
+          break;
+        case 9:  // std::vector<ESPConfig_t>
+          for (const auto v : val.as<std::vector<ESPConfigP_t>>()) {
+            v->writeJson(arr.createNestedObject());
+          }
+          break;
+        default:
+          break;
       }
+      break;
     }
   }
+}
 
-  return json;
+// a read only layer of values used for the keys not held in m_config
+ESPConfig& ESPConfig::defaults(const ESPConfigImage& image) {
+  m_defaults = image;
+#if defined(ESP8266)
+  m_defaultStrings.clear();
+#endif
+  ++m_revision;
+  return *this;
 }
 
-void ESPConfig::save() const {
-  if (m_useEeprom) {
-    auto json{toJSONObj()};
-    auto toWrite{measureJson(json)};
-    if (toWrite > m_eepromSize) {
-      Serial.printf_P(
-          PSTR("ESPConfig save error: the config data size %d is greater than "
-               "the available EEPROM size %d and the config data was not "
-               "saved.\n"
-               "Please increase the available EEPROM size using the "
-               "ESPCONFIG_EEPROMSIZE macro identifier.\n"),
-          toWrite, m_eepromSize);
-      return;
+// move the values already read for the bound keys into the bound struct
+ESPConfig& ESPConfig::bind(std::unique_ptr<schemaBinding> binding) {
+  m_binding = std::move(binding);
+  moveToBinding();
+  return *this;
+}
+
+// each bound key is looked up on its own and converted through a document
+// holding only its value, a value too large for it stays a regular value
+void ESPConfig::moveToBinding() {
+  DynamicJsonDocument json{m_jsonDocSize};
+  for (size_t index{0}; index < m_binding->size(); index++) {
+    auto key{m_binding->key(index)};
+    auto keyLen{strlen(key)};
+    loadPending(key, keyLen);
+    auto found{static_cast<const ESPConfig*>(this)->find(key, keyLen)};
+    if (found == m_config.end()) {
+      continue;
+    }
+
+    json.clear();
+    writeValue(json.to<JsonObject>(), key,
+               valueView{found->second, indexOf(found->second)});
+    if (json.overflowed()) {
+#if ESPCONFIG_STATS
+      ++m_stats.overflows;
+#endif
+      Serial.printf_P(PSTR("ESPConfig bind error: the value of key '%s' does "
+                           "not fit in ESPCONFIG_JSONDOCSIZE and is not "
+                           "bound\n"),
+                      key);
+      continue;
+    }
+    if (m_binding->readValue(key, json.as<JsonObjectConst>()[key])) {
+      remove(key);
     }
+  }
+}
+
+// true when the storage saved the config
+bool ESPConfig::save() const {
+  m_saved = false;
+  if (m_saveStorage) {
+#if ESPCONFIG_STATS
+    auto start{micros()};
+#endif
+    m_saveStorage->save(*this);
+#if ESPCONFIG_STATS
+    ++m_stats.saves;
+    m_stats.saveMicros += micros() - start;
+#endif
+  }
+  return m_saved;
+}
+
+// a bound object may have changed at any time, so it is always saved
+bool ESPConfig::changed() const {
+  return m_binding || dirty();
+}
+
+// a key is dirty after it was set or removed, or when a nested config it
+// holds is dirty
+bool ESPConfig::dirty() const {
+  return !m_dirty.empty() ||
+         std::any_of(m_config.begin(), m_config.end(),
+                     [](const config_t::value_type& kv) {
+                       return dirty(kv.second);
+                     });
+}
+
+bool ESPConfig::dirty(const configValue_t& value) {
+  auto nested{children(value)};
+  return std::any_of(nested.begin(), nested.end(),
+                     [](ESPConfigP_t child) { return child->dirty(); });
+}
 
-    EEPROM.begin(m_eepromSize);
-    EepromStream eepromStream(0, m_eepromSize);
-    serializeJson(json, eepromStream);
-    eepromStream.flush();
-    EEPROM.end();
+void ESPConfig::clean() const {
+  m_dirty.clear();
+  for (const auto& kv : m_config) {
+    for (auto child : children(kv.second)) {
+      child->clean();
+    }
+  }
+}
 
+void ESPConfig::clean(const char* key) const {
+  auto found{find(key, strlen(key))};
+  if (found != m_config.end()) {
+    m_dirty.erase(found->first);
+    for (auto child : children(found->second)) {
+      child->clean();
+    }
+  }
+}
+
+std::vector<ESPConfig::ESPConfigP_t> ESPConfig::children(
+    const configValue_t& value) {
+  if (holds<ESPConfigP_t>(&value)) {
+    return {get<ESPConfigP_t>(value)};
+  }
+  if (holds<std::vector<ESPConfigP_t>>(&value)) {
+    return get<std::vector<ESPConfigP_t>>(value);
+  }
+  return {};
+}
+
+// the bound keys and the dirty keys, with the dirty keys no longer held
+void ESPConfig::writeDirty(JsonObject json,
+                           std::vector<std::string>& removed) const {
+  if (m_binding) {
+    m_binding->writeJson(json);
+  }
+  for (const auto& kv : m_config) {
+    if (m_dirty.count(kv.first) || dirty(kv.second)) {
+      writeValue(json, kv.first->c_str(),
+                 valueView{kv.second, indexOf(kv.second)});
+    }
+  }
+  for (auto key : m_dirty) {
+    if (!m_config.count(key) && json[key->c_str()].isNull()) {
+      removed.push_back(*key);
+    }
+  }
+}
+
+// a key listed by a storage, read now when it is already held or may be bound
+void ESPConfig::defer(const char* key, ESPConfigStorage* storage) {
+  auto name{intern(key)};
+  m_dirty.erase(name);
+  if (m_binding || m_config.count(name)) {
+    storage->readKey(*this, key);
     return;
   }
+  m_pending[name] = storage;
+}
 
-  if (m_fileSys) {
-    // write configuration json to FS
-    if (m_configFileList.empty()) {
-      Serial.printf_P(PSTR("ESPConfig save error: no config file provided\n"));
-      return;
+// read a deferred key the first time it is used, loading a key leaves the
+// config unchanged as seen from outside so this is allowed on a const config
+bool ESPConfig::loadPending(const char* key, size_t keyLen) const {
+  if (m_pending.empty()) {
+    return false;
+  }
+  auto name{m_keys->find({key, keyLen})};
+  if (!name) {
+    return false;
+  }
+  auto found{m_pending.find(name)};
+  if (found == m_pending.end()) {
+    return false;
+  }
+  auto storage{found->second};
+  auto config{const_cast<ESPConfig*>(this)};
+  config->m_pending.erase(found);
+  return storage->readKey(*config, name->c_str());
+}
+
+void ESPConfig::loadPending() const {
+  while (!m_pending.empty()) {
+    auto key{m_pending.begin()->first};
+    loadPending(key->c_str(), key->size());
+  }
+}
+
+// the deferred keys whose storage pages their arrays, the other deferred keys
+// are loaded
+std::vector<std::pair<const std::string*, ESPConfigPager::source_t>>
+ESPConfig::pagedPending() const {
+  std::vector<std::pair<const std::string*, ESPConfigPager::source_t>> paged;
+  std::vector<const std::string*> load;
+  for (const auto& kv : m_pending) {
+    ESPConfigPager::source_t source;
+    if (kv.second->pages(kv.first->c_str(), source)) {
+      paged.emplace_back(kv.first, std::move(source));
+    } else {
+      load.push_back(kv.first);
     }
+  }
+  for (auto key : load) {
+    loadPending(key->c_str(), key->size());
+  }
+  return paged;
+}
+
+namespace {
+size_t stringHeap(const std::string& str) {
+  return str.capacity() > std::string{}.capacity() ? str.capacity() + 1 : 0;
+}
+}  // namespace
+
+// An estimate of the heap held by this config, its nested configs and the key
+// table they share. callBack is called for each key, with the path of the keys
+// of nested configs, the index of the value and the bytes of its entry and
+// value, the bytes of a nested config cover its object and table but not its
+// keys.
+size_t ESPConfig::memoryUsage(const usageCallBack_t& callBack) const {
+  auto bytes{m_config.bucket_count() * sizeof(void*) +
+             keyUsage(callBack, "") +
+             m_keys->keys.bucket_count() * sizeof(void*) +
+             m_keys->users.bucket_count() * sizeof(void*) +
+             m_keys->users.size() * 2 * sizeof(void*)};
+  for (const auto& key : m_keys->keys) {
+    bytes += sizeof(void*) + sizeof(key) + stringHeap(key.second);
+  }
+#if defined(ESP8266)
+  for (const auto& kv : m_defaultStrings) {
+    bytes += sizeof(void*) + sizeof(kv) + stringHeap(kv.second);
+  }
+#endif
+  return bytes;
+}
+
+size_t ESPConfig::keyUsage(const usageCallBack_t& callBack,
+                           const std::string& prefix) const {
+  size_t bytes{0};
+  for (const auto& kv : m_config) {
+    auto path{prefix + *kv.first};
+    auto entry{sizeof(void*) + sizeof(config_t::value_type) +
+               valueUsage(kv.second)};
+    if (callBack) {
+      callBack(path.c_str(), indexOf(kv.second), entry);
+    }
+    bytes += entry;
+
+    if (holds<ESPConfigP_t>(&kv.second)) {
+      bytes += get<ESPConfigP_t>(kv.second)->keyUsage(callBack, path + ".");
+    }
+    if (holds<std::vector<ESPConfigP_t>>(&kv.second)) {
+      const auto& children{get<std::vector<ESPConfigP_t>>(kv.second)};
+      for (auto i{0u}; i < children.size(); i++) {
+        bytes += children[i]->keyUsage(
+            callBack, path + "[" + std::to_string(i) + "].");
+      }
+    }
+  }
+  return bytes;
+}
+
+// the heap held by a value beyond its map entry, without the keys of the
+// nested configs it holds
+size_t ESPConfig::valueUsage(const configValue_t& value) const {
+  auto child{[](ESPConfigP_t config) {
+    return sizeof(ESPConfig) + config->m_config.bucket_count() * sizeof(void*);
+  }};
 
-    m_mountCB(m_fileSys);
-    auto configFile = m_fileSys->open(m_configFileList.at(0), "w");
-    if (configFile) {
-      auto json{toJSONObj()};
-      auto toWrite{measureJsonPretty(json)};
-      auto written{serializeJsonPretty(json, configFile)};
-      configFile.close();
-      if (written != toWrite) {
-        Serial.printf_P(
-            PSTR("ESPConfig save error: file system write failed, %d "
-                 "bytes written not %d\n"),
-            written, toWrite);
+  // the order must match the configValue_t variant definition
+  switch (indexOf(value)) {
+    case 3:  // std::string
+      return stringHeap(get<std::string>(value));
+    case 4:  // ESPConfig_t
+      return child(get<ESPConfigP_t>(value));
+    case 5:  // std::vector<bool>
+      return get<std::vector<bool>>(value).capacity() / 8;
+    case 6:  // std::vector<int32_t>
+      return get<std::vector<int32_t>>(value).capacity() * sizeof(int32_t);
+    case 7:  // std::vector<double>
+      return get<std::vector<double>>(value).capacity() * sizeof(double);
+    case 8: {  // std::vector<std::string>
+      const auto& values{get<std::vector<std::string>>(value)};
+      auto bytes{values.capacity() * sizeof(std::string)};
+      for (const auto& str : values) {
+        bytes += stringHeap(str);
       }
-    } else {
-      Serial.printf_P(PSTR("ESPConfig save error: unable to open config file "
-                           "'%s' for write\n"),
-                      m_configFileList[0]);
+      return bytes;
+    }
+    case 9: {  // std::vector<ESPConfig_t>
+      const auto& values{get<std::vector<ESPConfigP_t>>(value)};
+      auto bytes{values.capacity() * sizeof(ESPConfigP_t)};
+      for (const auto config : values) {
+        bytes += child(config);
+      }
+      return bytes;
     }
-    m_unmountCB(m_fileSys);
+    default:
+      return 0;
   }
+}
 
-  return;
+// Copy every value into a new allocation of its exact size, nested configs
+// first, and rehash the tables to their sizes. The new allocations are made
+// together, so the heap freed by earlier changes is reclaimed in one piece.
+// Nested configs are compacted in place, as they may be held outside this
+// config, and the keys no config sharing the table holds are dropped last.
+ESPConfig& ESPConfig::compact() {
+  compactValues();
+  purgeKeys();
+  m_keys->keys.rehash(0);
+  m_keys->users.rehash(0);
+  ++m_revision;
+  return *this;
 }
+
+void ESPConfig::compactValues() {
+  config_t fresh;
+  fresh.reserve(m_config.size());
+  for (const auto& kv : m_config) {
+    fresh.emplace(kv.first, compacted(kv.second));
+  }
+  m_config.swap(fresh);  // the nested configs now belong to the new values
+}
+
+// a key is held by a value, by a change not saved yet, or by a storage that
+// has not loaded it, in any of the configs sharing the table
+void ESPConfig::purgeKeys() const {
+  std::unordered_set<const std::string*> held;
+  for (auto user : m_keys->users) {
+    for (const auto& kv : user->m_config) {
+      held.insert(kv.first);
+    }
+    held.insert(user->m_dirty.begin(), user->m_dirty.end());
+    for (const auto& kv : user->m_pending) {
+      held.insert(kv.first);
+    }
+  }
+  auto& keys{m_keys->keys};
+  for (auto it{keys.begin()}; it != keys.end();) {
+    it = held.count(&it->second) ? std::next(it) : keys.erase(it);
+  }
+}
+
+// move a config and its nested configs to another key table, as a config
+// created on its own and then stored in this one still uses its own table
+void ESPConfig::adoptKeys(const std::shared_ptr<keyTable_t>& keys) {
+  if (m_keys == keys) {
+    return;
+  }
+  auto rekey{[&keys](const std::string* key) { return keys->intern(*key); }};
+
+  config_t config;
+  config.reserve(m_config.size());
+  for (auto& kv : m_config) {
+    config.emplace(rekey(kv.first), std::move(kv.second));
+  }
+  m_config.swap(config);
+  std::unordered_set<const std::string*> dirty;
+  for (auto key : m_dirty) {
+    dirty.insert(rekey(key));
+  }
+  m_dirty.swap(dirty);
+  std::unordered_map<const std::string*, ESPConfigStorage*> pending;
+  for (const auto& kv : m_pending) {
+    pending.emplace(rekey(kv.first), kv.second);
+  }
+  m_pending.swap(pending);
+
+  m_keys->users.erase(this);
+  m_keys = keys;
+  m_keys->users.insert(this);
+  for (const auto& kv : m_config) {
+    for (auto child : children(kv.second)) {
+      child->adoptKeys(keys);
+    }
+  }
+}
+
+ESPConfig::configValue_t ESPConfig::compacted(
+    const configValue_t& value) const {
+  // the order must match the configValue_t variant definition
+  switch (indexOf(value)) {
+    case 3:  // std::string
+      return std::string{get<std::string>(value)};
+    case 4:  // ESPConfig_t
+      return compacted(get<ESPConfigP_t>(value));
+    case 5:  // std::vector<bool>
+      return std::vector<bool>{get<std::vector<bool>>(value)};
+    case 6:  // std::vector<int32_t>
+      return std::vector<int32_t>{get<std::vector<int32_t>>(value)};
+    case 7:  // std::vector<double>
+      return std::vector<double>{get<std::vector<double>>(value)};
+    case 8:  // std::vector<std::string>
+      return std::vector<std::string>{get<std::vector<std::string>>(value)};
+    case 9: {  // std::vector<ESPConfig_t>
+      const auto& values{get<std::vector<ESPConfigP_t>>(value)};
+      std::vector<ESPConfigP_t> children;
+      children.reserve(values.size());
+      for (auto child : values) {
+        children.push_back(compacted(child));
+      }
+      return children;
+    }
+    default:
+      return value;
+  }
+}
+
+// compact a nested config in place, on the key table of this config
+ESPConfig::ESPConfigP_t ESPConfig::compacted(ESPConfigP_t child) const {
+  child->adoptKeys(m_keys);
+  child->compactValues();
+  return child;
+}
+
+#if ESPCONFIG_STATS
+// the counters of all instances with the keys and an estimate of the heap
+// held by this config, its nested configs and the key table they share
+ESPConfig::stats_t ESPConfig::stats() const {
+  auto stats{m_stats};
+  stats.keys = m_keys->keys.size();
+  stats.bytesHeld = memoryUsage();
+  return stats;
+}
+std::string ESPConfig::statsJSON(saveFormat format) const {
+  auto counters{stats()};
+  DynamicJsonDocument json{m_jsonDocSize};
+  json["lookups"] = counters.lookups;
+  json["hits"] = counters.hits;
+  json["misses"] = counters.misses;
+  json["allocations"] = counters.allocations;
+  json["keys"] = counters.keys;
+  json["bytesHeld"] = counters.bytesHeld;
+  json["reads"] = counters.reads;
+  json["readMicros"] = counters.readMicros;
+  json["readBytes"] = counters.readBytes;
+  json["saves"] = counters.saves;
+  json["saveMicros"] = counters.saveMicros;
+  json["saveBytes"] = counters.saveBytes;
+  json["eepromCommits"] = counters.eepromCommits;
+  json["overflows"] = counters.overflows;
+
+  std::string output;
+  switch (format) {
+    case saveFormat::minified:
+      serializeJson(json, output);
+      break;
+    case saveFormat::pretty:
+      serializeJsonPretty(json, output);
+      break;
+    case saveFormat::msgPack:
+      serializeMsgPack(json, output);
+      break;
+    default:
+      break;
+  }
+  return output;
+}
+
+void ESPConfig::resetStats() {
+  m_stats = {};
+}
+#endif
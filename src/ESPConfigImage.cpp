@@ -0,0 +1,733 @@
+#include "ESPConfig.hpp"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
+#if defined(ESP32)
+# include <esp_partition.h>
+#elif defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+ESPConfigImage::ESPConfigImage(const uint8_t* data, size_t size,
+                               size_t loaded)
+    : m_data{data}, m_size{size}, m_loaded{std::min(size, loaded)} {
+  if (m_data == nullptr || m_loaded < headerSize ||
+      read<uint32_t>(0) != magic || read<uint16_t>(4) != version ||
+      read<uint32_t>(8) != m_size || !valid()) {
+    Serial.printf_P(PSTR("ESPConfig image error: invalid config image\n"));
+    m_data = nullptr;
+    m_size = 0;
+    m_loaded = 0;
+    return;
+  }
+  m_root = read<uint32_t>(12);
+}
+
+// Walk every node from the root, checking each offset against the loaded
+// bytes before it is followed. A string is terminated inside the image when a
+// NUL lies between it and the last NUL of the image. The entries and offsets
+// visited are limited to those the image could hold, so nodes shared or
+// referring back to themselves cannot loop.
+bool ESPConfigImage::valid() const {
+  size_t lastNul{m_loaded};
+  while (lastNul > 0 && read<uint8_t>(lastNul - 1) != 0) {
+    --lastNul;
+  }
+  auto terminated{[lastNul](uint32_t offset) { return offset < lastNul; }};
+
+  size_t budget{m_loaded / sizeof(uint32_t)};
+  std::vector<uint32_t> nodes{read<uint32_t>(12)};
+  while (!nodes.empty()) {
+    auto node{nodes.back()};
+    nodes.pop_back();
+    if (!inside(node, 1, sizeof(uint32_t), m_loaded)) {
+      return false;
+    }
+    auto count{read<uint32_t>(node)};
+    if (!inside(node + sizeof(uint32_t), count, entrySize, m_loaded) ||
+        count > budget) {
+      return false;
+    }
+    budget -= count;
+
+    for (auto i{0u}; i < count; i++) {
+      auto entry{entryAt(node + sizeof(uint32_t) + i * entrySize)};
+      if (!terminated(entry.key)) {
+        return false;
+      }
+
+      // the order must match the configValue_t variant definition
+      switch (entry.type) {
+        case 0:  // bool
+        case 1:  // int32_t
+          break;
+        case 2:  // double
+          if (!inside(entry.value, 1, sizeof(double), m_loaded)) {
+            return false;
+          }
+          break;
+        case 3:  // std::string, count bytes then a NUL
+          if (!inside(entry.value, (size_t)entry.count + 1, 1, m_loaded) ||
+              read<uint8_t>(entry.value + entry.count) != 0) {
+            return false;
+          }
+          break;
+        case 4:  // ESPConfig_t
+          nodes.push_back(entry.value);
+          break;
+        case 5:    // std::vector<bool>
+        case 6:    // std::vector<int32_t>
+        case 7: {  // std::vector<double>, loaded or entirely after the loaded
+          auto elemSize{entry.type == 5   ? sizeof(uint8_t)
+                        : entry.type == 6 ? sizeof(int32_t)
+                                          : sizeof(double)};
+          if (!inside(entry.value, entry.count, elemSize, m_loaded) &&
+              !(entry.value >= m_loaded &&
+                inside(entry.value, entry.count, elemSize, m_size))) {
+            return false;
+          }
+          break;
+        }
+        case 8:    // std::vector<std::string>
+        case 9: {  // std::vector<ESPConfig_t>
+          if (!inside(entry.value, entry.count, sizeof(uint32_t), m_loaded) ||
+              entry.count > budget) {
+            return false;
+          }
+          budget -= entry.count;
+          for (auto j{0u}; j < entry.count; j++) {
+            auto offset{read<uint32_t>(entry.value + j * sizeof(uint32_t))};
+            if (entry.type == 9) {
+              nodes.push_back(offset);
+            } else if (!terminated(offset)) {
+              return false;
+            }
+          }
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+#if defined(ESP32)
+// map a data partition holding an image
+ESPConfigImage ESPConfigImage::mapPartition(const char* label) {
+  auto partition{esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_ANY, label)};
+  if (!partition) {
+    Serial.printf_P(PSTR("ESPConfig image error: partition '%s' not found\n"),
+                    label);
+    return {};
+  }
+
+  const void* data;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA,
+                         &data, &handle) != ESP_OK) {
+    Serial.printf_P(PSTR("ESPConfig image error: unable to map partition "
+                         "'%s'\n"),
+                    label);
+    return {};
+  }
+
+  uint32_t size;
+  memcpy(&size, (const uint8_t*)data + 8, sizeof(size));
+  ESPConfigImage image{(const uint8_t*)data,
+                       std::min<size_t>(size, partition->size)};
+  image.m_mapping = std::shared_ptr<const void>{
+      data, [handle](const void*) { spi_flash_munmap(handle); }};
+  return image;
+}
+#elif defined(__unix__) || defined(__APPLE__)
+// map a file holding an image
+ESPConfigImage ESPConfigImage::mapFile(const char* fileName) {
+  auto fd{open(fileName, O_RDONLY)};
+  if (fd < 0) {
+    Serial.printf_P(PSTR("ESPConfig image error: unable to open '%s'\n"),
+                    fileName);
+    return {};
+  }
+
+  struct stat st;
+  auto data{fstat(fd, &st) == 0 && st.st_size > 0
+    ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+    : MAP_FAILED};
+  close(fd);
+  if (data == MAP_FAILED) {
+    Serial.printf_P(PSTR("ESPConfig image error: unable to map '%s'\n"),
+                    fileName);
+    return {};
+  }
+
+  size_t size{(size_t)st.st_size};
+  ESPConfigImage image{(const uint8_t*)data, size};
+  image.m_mapping = std::shared_ptr<const void>{
+      data, [size](const void* ptr) { munmap((void*)ptr, size); }};
+  return image;
+}
+#endif
+
+// find a key, or walk a path such as "mqtt.tls.caFile" or "sensors[3].gain",
+// with the grammar of ESPConfig::walk, which reports malformed paths
+bool ESPConfigImage::lookup(const char* path, entry_t& entry) const {
+  if (!*this) {
+    return false;
+  }
+
+  auto node{m_root};
+  while (true) {
+    auto len{strcspn(path, ".[")};
+    if (!find(node, path, len, entry)) {
+      return false;
+    }
+    path += len;
+
+    switch (*path) {
+      case '\0':
+        return true;
+      case '.':
+        if (entry.type != 4) {
+          return false;
+        }
+        node = entry.value;
+        ++path;
+        break;
+      case '[': {
+        char* end{nullptr};
+        auto index{isdigit((unsigned char)path[1]) ? strtoul(path + 1, &end, 10)
+                                                   : 0};
+        if (!end || *end != ']' || end[1] != '.' || entry.type != 9 ||
+            index >= entry.count) {
+          return false;
+        }
+        node = read<uint32_t>(entry.value + index * sizeof(uint32_t));
+        path = end + 2;
+        break;
+      }
+    }
+  }
+}
+
+// binary search the sorted entries of a node
+bool ESPConfigImage::find(uint32_t node, const char* key, size_t keyLen,
+                          entry_t& entry) const {
+  if (!inside(node, 1, sizeof(uint32_t), m_loaded)) {
+    return false;
+  }
+  auto count{read<uint32_t>(node)};
+  if (!inside(node + sizeof(uint32_t), count, entrySize, m_loaded)) {
+    return false;
+  }
+
+  auto first{node + sizeof(uint32_t)};
+  size_t low{0}, high{count};
+  while (low < high) {
+    auto mid{(low + high) / 2};
+    auto at{first + mid * entrySize};
+    auto name{(const char*)m_data + read<uint32_t>(at)};
+    auto cmp{strncmp_P(key, name, keyLen)};
+    if (cmp == 0 && pgm_read_byte(name + keyLen) != '\0') {
+      cmp = -1;  // the entry key is longer
+    }
+    if (cmp == 0) {
+      entry = entryAt(at);
+      return true;
+    }
+    if (cmp < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return false;
+}
+
+ESPConfigImage::entry_t ESPConfigImage::entryAt(uint32_t offset) const {
+  return {
+    read<uint32_t>(offset),
+    read<uint8_t>(offset + 4),
+    read<uint32_t>(offset + 8),
+    read<uint32_t>(offset + 12),
+  };
+}
+
+std::string ESPConfigImage::key(const entry_t& entry) const {
+  auto name{(const char*)m_data + entry.key};
+  std::string str(strlen_P(name), '\0');
+  memcpy_P(&str[0], name, str.size());
+  return str;
+}
+
+// the node of an element of an array of objects
+uint32_t ESPConfigImage::node(const entry_t& entry, size_t index) const {
+  return (entry.type == 9 && index < entry.count)
+    ? read<uint32_t>(entry.value + index * sizeof(uint32_t))
+    : 0;
+}
+
+// ---- build ----
+
+// writes an image following the same rules as ESPConfig::readJson, from a JSON
+// object or straight from the values held by a config
+class ESPConfigImage::imageWriter {
+  public:
+    std::string image(JsonObjectConst json, size_t tailCount) {
+      begin(tailCount);
+      return end(node(json, true));
+    }
+
+    std::string image(const ESPConfig& config, size_t tailCount) {
+      begin(tailCount);
+      return end(node(config, true));
+    }
+
+  private:
+    using configValue_t = ESPConfig::configValue_t;
+
+    struct entry_t {
+      uint32_t key;
+      uint8_t type;
+      uint32_t count;
+      uint32_t value;
+    };
+
+    // a key and its value, either a JSON value or one held by a config
+    struct item_t {
+      const char* key;
+      JsonVariantConst json;
+      const configValue_t* value;
+    };
+
+    // a top level array written after everything else, type 0 for none
+    struct tail_t {
+      size_t at;
+      uint8_t type;
+      JsonArrayConst arr;
+      const configValue_t* value;
+    };
+
+    void begin(size_t tailCount) {
+      m_tailCount = tailCount;
+      m_image.assign(ESPConfigImage::headerSize, '\0');
+    }
+
+    std::string end(uint32_t root) {
+      for (const auto& tail : m_tail) {
+        put(tail.at, tail.value ? array(tail.type, *tail.value)
+                                : array(tail.type, tail.arr));
+      }
+      align(4);
+      put(0, ESPConfigImage::magic);
+      put(4, ESPConfigImage::version);
+      put(6, (uint16_t)0);
+      put(8, (uint32_t)m_image.size());
+      put(12, root);
+      return std::move(m_image);
+    }
+
+    void align(size_t size) {
+      m_image.resize((m_image.size() + size - 1) / size * size, '\0');
+    }
+
+    template <typename T>
+    void put(size_t offset, const T& val) {
+      memcpy(&m_image[offset], &val, sizeof(T));
+    }
+
+    template <typename T>
+    uint32_t append(const T* data, size_t count, size_t alignment = 4) {
+      align(alignment);
+      auto offset{(uint32_t)m_image.size()};
+      m_image.append((const char*)data, count * sizeof(T));
+      return offset;
+    }
+
+    uint32_t string(const char* str) {
+      str = str ? str : "";
+      auto found{m_strings.find(str)};
+      if (found != m_strings.end()) {
+        return found->second;
+      }
+      auto offset{append(str, strlen(str) + 1, 1)};
+      m_strings.emplace(str, offset);
+      return offset;
+    }
+
+    template <typename T, typename S = T>
+    uint32_t array(JsonArrayConst arr, size_t alignment = 4) {
+      std::vector<S> values;
+      values.reserve(arr.size());
+      for (auto val : arr) {
+        values.push_back(val.as<T>());
+      }
+      return append(values.data(), values.size(), alignment);
+    }
+
+    uint32_t array(uint8_t type, JsonArrayConst arr) {
+      return type == 5   ? array<bool, uint8_t>(arr, 1)
+             : type == 6 ? array<int32_t>(arr)
+                         : array<double>(arr, sizeof(double));
+    }
+
+    // the order must match the configValue_t variant definition
+    uint32_t array(uint8_t type, const configValue_t& val) {
+      if (type == 5) {
+        const auto& bools{ESPConfig::get<std::vector<bool>>(val)};
+        std::vector<uint8_t> values{bools.begin(), bools.end()};
+        return append(values.data(), values.size(), 1);
+      }
+      if (type == 6) {
+        const auto& ints{ESPConfig::get<std::vector<int32_t>>(val)};
+        return append(ints.data(), ints.size());
+      }
+      const auto& dbls{ESPConfig::get<std::vector<double>>(val)};
+      return append(dbls.data(), dbls.size(), sizeof(double));
+    }
+
+    bool entry(JsonVariantConst val, entry_t& entry, const bool tail) {
+      entry.count = 0;
+
+      if (val.is<bool>()) {
+        entry.type = 0;
+        entry.value = val.as<bool>();
+        return true;
+      }
+
+      if (val.is<int32_t>()) {
+        entry.type = 1;
+        entry.value = (uint32_t)val.as<int32_t>();
+        return true;
+      }
+
+      if (val.is<double>()) {
+        auto dbl{val.as<double>()};
+        entry.type = 2;
+        entry.value = append(&dbl, 1, sizeof(double));
+        return true;
+      }
+
+      if (val.is<const char*>()) {
+        entry.type = 3;
+        entry.count = strlen(val.as<const char*>());
+        entry.value = string(val.as<const char*>());
+        return true;
+      }
+
+      if (val.is<JsonObjectConst>()) {
+        entry.type = 4;
+        entry.value = node(val.as<JsonObjectConst>());
+        return true;
+      }
+
+      if (!val.is<JsonArrayConst>() || val.as<JsonArrayConst>().size() == 0) {
+        return false;
+      }
+
+      auto arr{val.as<JsonArrayConst>()};
+      entry.count = arr.size();
+      entry.type = arr[0].is<bool>()              ? 5
+                   : arr[0].is<int32_t>()         ? 6
+                   : arr[0].is<double>()          ? 7
+                   : arr[0].is<const char*>()     ? 8
+                   : arr[0].is<JsonObjectConst>() ? 9
+                                                  : 0;
+
+      if (entry.type >= 5 && entry.type <= 7) {
+        entry.value = tail ? 0 : array(entry.type, arr);
+        return true;
+      }
+
+      if (entry.type == 8) {
+        std::vector<uint32_t> offsets;
+        offsets.reserve(arr.size());
+        for (auto elem : arr) {
+          offsets.push_back(string(elem.as<const char*>()));
+        }
+        entry.value = append(offsets.data(), offsets.size());
+        return true;
+      }
+
+      if (entry.type == 9) {
+        std::vector<uint32_t> offsets;
+        offsets.reserve(arr.size());
+        for (auto elem : arr) {
+          offsets.push_back(node(elem.as<JsonObjectConst>()));
+        }
+        entry.value = append(offsets.data(), offsets.size());
+        return true;
+      }
+
+      return false;
+    }
+
+    // the order must match the configValue_t variant definition
+    bool entry(const ESPConfig& config, const configValue_t& val,
+               entry_t& entry, const bool tail) {
+      entry.type = config.indexOf(val);
+      entry.count = count(config, val);
+
+      switch (entry.type) {
+        case 0:  // bool
+          entry.value = ESPConfig::get<bool>(val);
+          return true;
+        case 1:  // int32_t
+          entry.value = (uint32_t)ESPConfig::get<int32_t>(val);
+          return true;
+        case 2:  // double
+          entry.value = append(&ESPConfig::get<double>(val), 1, sizeof(double));
+          return true;
+        case 3:  // std::string
+          entry.count = strlen(ESPConfig::get<std::string>(val).c_str());
+          entry.value = string(ESPConfig::get<std::string>(val).c_str());
+          return true;
+        case 4:  // ESPConfig_t
+          entry.value = node(*ESPConfig::get<ESPConfig::ESPConfigP_t>(val));
+          return true;
+        case 5:  // std::vector<bool>
+        case 6:  // std::vector<int32_t>
+        case 7:  // std::vector<double>
+          entry.value = tail ? 0 : array(entry.type, val);
+          return entry.count != 0;
+        case 8: {  // std::vector<std::string>
+          std::vector<uint32_t> offsets;
+          offsets.reserve(entry.count);
+          for (const auto& str :
+               ESPConfig::get<std::vector<std::string>>(val)) {
+            offsets.push_back(string(str.c_str()));
+          }
+          entry.value = append(offsets.data(), offsets.size());
+          return entry.count != 0;
+        }
+        case 9: {  // std::vector<ESPConfig_t>
+          std::vector<uint32_t> offsets;
+          offsets.reserve(entry.count);
+          for (auto child :
+               ESPConfig::get<std::vector<ESPConfig::ESPConfigP_t>>(val)) {
+            offsets.push_back(node(*child));
+          }
+          entry.value = append(offsets.data(), offsets.size());
+          return entry.count != 0;
+        }
+        default:
+          return false;
+      }
+    }
+
+    // the elements of an array value, 0 for any other value
+    // the order must match the configValue_t variant definition
+    static size_t count(const ESPConfig& config, const configValue_t& val) {
+      switch (config.indexOf(val)) {
+        case 5:
+          return ESPConfig::get<std::vector<bool>>(val).size();
+        case 6:
+          return ESPConfig::get<std::vector<int32_t>>(val).size();
+        case 7:
+          return ESPConfig::get<std::vector<double>>(val).size();
+        case 8:
+          return ESPConfig::get<std::vector<std::string>>(val).size();
+        case 9:
+          return ESPConfig::get<std::vector<ESPConfig::ESPConfigP_t>>(val)
+              .size();
+        default:
+          return 0;
+      }
+    }
+
+    uint32_t node(JsonObjectConst json, const bool root = false) {
+      std::vector<item_t> items;
+      items.reserve(json.size());
+      for (auto kv : json) {
+        items.push_back({kv.key().c_str(), kv.value(), nullptr});
+      }
+      return node(nullptr, items, root);
+    }
+
+    // the values of a bound struct are written through a JSON document kept
+    // until the image is done, the saved marker of the root is left out
+    uint32_t node(const ESPConfig& config, const bool root = false) {
+      config.loadPending();
+      std::vector<item_t> items;
+      items.reserve(config.m_config.size());
+      if (config.m_binding) {
+        m_bound.emplace_back(m_jsonDocSize);
+        config.m_binding->writeJson(m_bound.back().to<JsonObject>());
+        for (auto kv : m_bound.back().as<JsonObjectConst>()) {
+          items.push_back({kv.key().c_str(), kv.value(), nullptr});
+        }
+      }
+      auto saved{reinterpret_cast<const char*>(ESPCONFIG_SAVEDKEY)};
+      for (const auto& kv : config.m_config) {
+        if (!root || strcmp_P(kv.first->c_str(), saved) != 0) {
+          items.push_back({kv.first->c_str(), JsonVariantConst{}, &kv.second});
+        }
+      }
+      return node(&config, items, root);
+    }
+
+    uint32_t node(const ESPConfig* config, std::vector<item_t>& items,
+                  const bool root) {
+      std::sort(items.begin(), items.end(),
+                [](const item_t& a, const item_t& b) {
+                  return strcmp(a.key, b.key) < 0;
+                });
+
+      std::vector<entry_t> entries;
+      std::vector<tail_t> tails;
+      entries.reserve(items.size());
+      for (const auto& item : items) {
+        auto size{item.value ? count(*config, *item.value)
+                             : item.json.as<JsonArrayConst>().size()};
+        auto tail{root && m_tailCount != 0 && size >= m_tailCount};
+        entry_t ent;
+        if (item.value ? entry(*config, *item.value, ent, tail)
+                       : entry(item.json, ent, tail)) {
+          ent.key = string(item.key);
+          entries.push_back(ent);
+          tails.push_back(!tail        ? tail_t{}
+                          : item.value ? tail_t{0, ent.type, {}, item.value}
+                                       : tail_t{0, ent.type,
+                                                item.json.as<JsonArrayConst>(),
+                                                nullptr});
+        }
+      }
+
+      align(4);
+      auto offset{(uint32_t)m_image.size()};
+      m_image.resize(offset + sizeof(uint32_t) +
+                     entries.size() * ESPConfigImage::entrySize, '\0');
+      put(offset, (uint32_t)entries.size());
+      auto at{offset + sizeof(uint32_t)};
+      for (auto i{0u}; i < entries.size(); i++) {
+        const auto& ent{entries[i]};
+        put(at, ent.key);
+        put(at + 4, ent.type);
+        put(at + 8, ent.count);
+        put(at + 12, ent.value);
+        if (tails[i].type >= 5 && tails[i].type <= 7) {
+          tails[i].at = at + 12;
+          m_tail.push_back(tails[i]);
+        }
+        at += ESPConfigImage::entrySize;
+      }
+      return offset;
+    }
+
+    size_t m_tailCount{0};
+    std::vector<tail_t> m_tail;
+    std::string m_image;
+    std::unordered_map<std::string, uint32_t> m_strings;
+    std::list<DynamicJsonDocument> m_bound;
+};
+
+// build an image from a JSON object, e.g. to cache a parsed configuration
+std::string ESPConfigImage::build(JsonObjectConst json, size_t tailCount) {
+  return imageWriter{}.image(json, tailCount);
+}
+
+// build an image from the values of a config, its nested configs and any
+// struct bound to them, without a JSON document holding the whole config
+std::string ESPConfigImage::build(const ESPConfig& config, size_t tailCount) {
+  return imageWriter{}.image(config, tailCount);
+}
+
+// ---- value ----
+
+template <>
+bool ESPConfigImage::value(const entry_t& entry) const {
+  return is<bool>(entry) && entry.value != 0;
+}
+
+template <>
+int32_t ESPConfigImage::value(const entry_t& entry) const {
+  return is<int32_t>(entry) ? (int32_t)entry.value : 0;
+}
+
+template <>
+double ESPConfigImage::value(const entry_t& entry) const {
+  return is<double>(entry) ? read<double>(entry.value) : 0.0;
+}
+
+template <>
+std::string ESPConfigImage::value(const entry_t& entry) const {
+  if (!is<std::string>(entry)) {
+    return {};
+  }
+  std::string str(entry.count, '\0');
+  memcpy_P(&str[0], m_data + entry.value, entry.count);
+  return str;
+}
+
+// on the ESP8266 the string is in flash, use the _P functions to access it
+template <>
+const char* ESPConfigImage::value(const entry_t& entry) const {
+  return is<const char*>(entry) ? (const char*)m_data + entry.value : "";
+}
+
+template <>
+std::array<double, 2> ESPConfigImage::value(const entry_t& entry) const {
+  return is<std::array<double, 2>>(entry) && resident(entry)
+    ? std::array<double, 2>{
+        read<double>(entry.value),
+        read<double>(entry.value + sizeof(double)),
+      }
+    : std::array<double, 2>{};
+}
+
+template <>
+std::vector<bool> ESPConfigImage::value(const entry_t& entry) const {
+  std::vector<bool> values{};
+  if (is<std::vector<bool>>(entry) && resident(entry)) {
+    values.reserve(entry.count);
+    for (auto i{0u}; i < entry.count; i++) {
+      values.push_back(read<uint8_t>(entry.value + i) != 0);
+    }
+  }
+  return values;
+}
+
+template <>
+std::vector<int32_t> ESPConfigImage::value(const entry_t& entry) const {
+  std::vector<int32_t> values{};
+  if (is<std::vector<int32_t>>(entry) && resident(entry) && entry.count != 0) {
+    values.resize(entry.count);
+    memcpy_P(values.data(), m_data + entry.value,
+             entry.count * sizeof(int32_t));
+  }
+  return values;
+}
+
+template <>
+std::vector<double> ESPConfigImage::value(const entry_t& entry) const {
+  std::vector<double> values{};
+  if (is<std::vector<double>>(entry) && resident(entry) && entry.count != 0) {
+    values.resize(entry.count);
+    memcpy_P(values.data(), m_data + entry.value,
+             entry.count * sizeof(double));
+  }
+  return values;
+}
+
+template <>
+std::vector<std::string> ESPConfigImage::value(const entry_t& entry) const {
+  std::vector<std::string> values{};
+  if (is<std::vector<std::string>>(entry)) {
+    values.reserve(entry.count);
+    for (auto i{0u}; i < entry.count; i++) {
+      auto str{(const char*)m_data +
+               read<uint32_t>(entry.value + i * sizeof(uint32_t))};
+      values.emplace_back(strlen_P(str), '\0');
+      memcpy_P(&values.back()[0], str, values.back().size());
+    }
+  }
+  return values;
+}
@@ -0,0 +1,137 @@
+#include "ESPConfigLZSS.hpp"
+
+#include <algorithm>
+
+// a greedy search of the window for the longest match, O(n * windowSize)
+// byte compares for n bytes of data. Empty when the data is too long for the
+// header, the caller then saves it uncompressed.
+std::string ESPConfigLZSS::compress(const std::string& data) {
+  std::string out;
+  if (data.size() > UINT16_MAX) {
+    return out;
+  }
+
+  out.reserve(headerSize + data.size() / 2);
+  out += (char)magic;
+  out += (char)version;
+  out += (char)(data.size() & 0xFF);
+  out += (char)(data.size() >> 8);
+
+  auto in{(const uint8_t*)data.data()};
+  size_t pos{0}, flagPos{0};
+  uint8_t bit{8};
+  while (pos < data.size()) {
+    if (bit == 8) {
+      flagPos = out.size();
+      out += '\0';
+      bit = 0;
+    }
+
+    size_t bestLen{0}, bestOffset{0};
+    auto maxLen{std::min(maxMatch, data.size() - pos)};
+    for (auto from{pos > windowSize ? pos - windowSize : 0}; from < pos;
+         from++) {
+      size_t len{0};
+      while (len < maxLen && in[from + len] == in[pos + len]) {
+        len++;
+      }
+      if (len > bestLen) {
+        bestLen = len;
+        bestOffset = pos - from;
+        if (len == maxLen) {
+          break;
+        }
+      }
+    }
+
+    if (bestLen >= minMatch) {
+      auto token{(uint16_t)(((bestOffset - 1) << 6) | (bestLen - minMatch))};
+      out += (char)(token >> 8);
+      out += (char)(token & 0xFF);
+      pos += bestLen;
+    } else {
+      out[flagPos] |= (char)(1 << bit);
+      out += (char)in[pos++];
+    }
+    bit++;
+  }
+
+  return out;
+}
+
+// ---- reader ----
+
+bool ESPConfigLZSS::reader::begin() {
+  uint8_t header[headerSize];
+  if (!m_window ||
+      m_in.readBytes((char*)header, headerSize) != headerSize ||
+      header[0] != magic || header[1] != version) {
+    return false;
+  }
+  m_length = header[2] | (header[3] << 8);
+  return true;
+}
+
+int ESPConfigLZSS::reader::available() {
+  return m_length - m_pos + (m_peek >= 0);
+}
+
+int ESPConfigLZSS::reader::read() {
+  if (m_peek >= 0) {
+    auto c{m_peek};
+    m_peek = -1;
+    return c;
+  }
+  return next();
+}
+
+int ESPConfigLZSS::reader::peek() {
+  if (m_peek < 0) {
+    m_peek = next();
+  }
+  return m_peek;
+}
+
+int ESPConfigLZSS::reader::next() {
+  if (m_pos >= m_length) {
+    return -1;
+  }
+
+  if (m_matchLeft == 0) {
+    if (m_flags <= 1) {
+      auto flags{m_in.read()};
+      if (flags < 0) {
+        return -1;
+      }
+      m_flags = flags | 0x100;
+    }
+
+    auto literal{m_flags & 1};
+    m_flags >>= 1;
+    if (literal) {
+      auto c{m_in.read()};
+      if (c < 0) {
+        return -1;
+      }
+      m_window[m_pos++ % windowSize] = c;
+      return c;
+    }
+
+    auto high{m_in.read()}, low{m_in.read()};
+    if (high < 0 || low < 0) {
+      return -1;
+    }
+    auto token{(uint16_t)((high << 8) | low)};
+    auto offset{(size_t)(token >> 6) + 1};
+    if (offset > m_pos) {
+      return -1;
+    }
+    m_matchFrom = m_pos - offset;
+    m_matchLeft = (token & 0x3F) + minMatch;
+  }
+
+  auto c{m_window[m_matchFrom++ % windowSize]};
+  m_window[m_pos++ % windowSize] = c;
+  m_matchLeft--;
+  return c;
+}
@@ -0,0 +1,45 @@
+#include "ESPConfigPaged.hpp"
+
+#include <algorithm>
+
+bool ESPConfigPager::read(uint32_t offset, void* data, size_t size) {
+  if (offset + size > m_length) {
+    return false;
+  }
+
+  auto out{(uint8_t*)data};
+  while (size != 0) {
+    auto found{page(offset / m_pageSize * m_pageSize)};
+    if (!found) {
+      return false;
+    }
+    auto start{offset - found->offset};
+    auto len{std::min<size_t>(size, m_pageSize - start)};
+    memcpy(out, found->data + start, len);
+    out += len;
+    offset += len;
+    size -= len;
+  }
+  return true;
+}
+
+// the page starting at offset, read in place of the least recently used page
+const ESPConfigPager::page_t* ESPConfigPager::page(uint32_t offset) {
+  auto found{std::find_if(
+      m_pages.begin(), m_pages.end(),
+      [offset](const page_t& page) { return page.offset == offset; })};
+  if (found == m_pages.end()) {
+    found = std::min_element(m_pages.begin(), m_pages.end(),
+                             [](const page_t& a, const page_t& b) {
+                               return a.used < b.used;
+                             });
+    auto len{std::min<size_t>(m_pageSize, m_length - offset)};
+    if (!m_reader(offset, found->data, len)) {
+      found->offset = UINT32_MAX;
+      return nullptr;
+    }
+    found->offset = offset;
+  }
+  found->used = ++m_clock;
+  return &*found;
+}
@@ -0,0 +1,75 @@
+#include "ESPConfigScheduler.hpp"
+
+#include <algorithm>
+
+namespace {
+constexpr uint32_t m_hour{3600000u};
+}  // namespace
+
+void ESPConfigScheduler::requestSave() {
+  auto now{(uint32_t)millis()};
+  if (!m_pending) {
+    m_pending = true;
+    m_first = now;
+  }
+  m_last = now;
+  ++m_counters.requests;
+}
+
+// call from loop(), the times are compared by difference so millis() may wrap
+void ESPConfigScheduler::handle() {
+  if (!m_pending) {
+    return;
+  }
+
+  auto now{(uint32_t)millis()};
+  if (now - m_last < m_quiet && now - m_first < m_maxDelay) {
+    return;
+  }
+  if (!m_config.changed()) {
+    m_pending = false;  // saved elsewhere, or set back, since the request
+    m_throttled = false;
+    return;
+  }
+  if (!budgetLeft(now)) {
+    if (!m_throttled) {
+      m_throttled = true;
+      ++m_counters.throttled;
+    }
+    return;
+  }
+  save(now);
+}
+
+void ESPConfigScheduler::flushNow() {
+  if (m_pending && save(millis())) {
+    ++m_counters.flushes;
+  }
+}
+
+bool ESPConfigScheduler::budgetLeft(uint32_t now) const {
+  return m_saveTimes.empty() || m_saved < m_saveTimes.size() ||
+         now - m_saveTimes[m_next] >= m_hour;
+}
+
+// a failed save is not retried until the next request, so a broken storage is
+// not written on every handle()
+bool ESPConfigScheduler::save(uint32_t now) {
+  m_pending = false;
+  m_throttled = false;
+  if (!m_config.changed()) {
+    return false;
+  }
+  if (!m_config.save()) {
+    ++m_counters.failed;
+    return false;
+  }
+  ++m_counters.saves;
+
+  if (!m_saveTimes.empty()) {
+    m_saveTimes[m_next] = now;
+    m_next = (m_next + 1) % m_saveTimes.size();
+    m_saved = std::min(m_saved + 1, m_saveTimes.size());
+  }
+  return true;
+}
@@ -0,0 +1,856 @@
+#include "ESPConfigStorage.hpp"
+
+#include <algorithm>
+
+#if ESPCONFIG_PARALLEL > 1
+# include <thread>
+# if defined(ESP32)
+#  include <esp_pthread.h>
+# endif
+#endif
+
+#if ESPCONFIG_COMPRESS
+# include "ESPConfigLZSS.hpp"
+#endif
+
+// ---- ESPConfigStorage ----
+
+// the keys read from a storage are no longer dirty
+void ESPConfigStorage::readJson(ESPConfig& config, JsonObjectConst json) {
+#if ESPCONFIG_STATS
+  stats().readBytes += measureJson(json);
+#endif
+  config.readJson(json);
+  for (auto kv : json) {
+    config.clean(kv.key().c_str());
+  }
+}
+
+void ESPConfigStorage::readValue(ESPConfig& config, const char* key,
+                                 JsonVariantConst value) {
+#if ESPCONFIG_STATS
+  stats().readBytes += measureMsgPack(value);
+#endif
+  config.readValue(key, value);
+  config.clean(key);
+}
+
+void ESPConfigStorage::readImage(ESPConfig& config,
+                                 const ESPConfigImage& image,
+                                 uint32_t resident) {
+#if ESPCONFIG_STATS
+  stats().readBytes += std::min<size_t>(image.size(), resident);
+#endif
+  config.readImage(image, image.root(), resident);
+  image.forEach(image.root(),
+                [&config, &image](const ESPConfigImage::entry_t& entry) {
+                  config.clean(image.key(entry).c_str());
+                });
+  if (config.m_binding) {
+    config.moveToBinding();
+  }
+}
+
+void ESPConfigStorage::readPaged(ESPConfig& config, const char* key,
+                                 const ESPConfigPager::source_t& source) {
+#if ESPCONFIG_STATS
+  stats().readBytes += source.count * (source.type == 5   ? sizeof(uint8_t)
+                                       : source.type == 6 ? sizeof(int32_t)
+                                                          : sizeof(double));
+#endif
+  config.readPaged(key, source);
+  config.clean(key);
+}
+
+DynamicJsonDocument ESPConfigStorage::toJSONObj(const ESPConfig& config) {
+  return config.toJSONObj();
+}
+
+void ESPConfigStorage::writeDirty(const ESPConfig& config, JsonObject json,
+                                  std::vector<std::string>& removed) {
+  config.writeDirty(json, removed);
+}
+
+DeserializationError ESPConfigStorage::deserialize(DynamicJsonDocument& json,
+                                                   Stream& stream) {
+  auto error{parse(json, stream)};
+#if ESPCONFIG_STATS
+  stats().overflows += error == DeserializationError::NoMemory;
+#endif
+  return error;
+}
+
+DeserializationError ESPConfigStorage::parse(DynamicJsonDocument& json,
+                                             Stream& stream) {
+#if ESPCONFIG_COMPRESS
+  if (stream.peek() == ESPConfigLZSS::magic) {
+    ESPConfigLZSS::reader reader{stream};
+    if (!reader) {
+      return DeserializationError::NoMemory;
+    }
+    return reader.begin() ? deserializeJson(json, reader)
+                          : DeserializationError::InvalidInput;
+  }
+#endif
+  return deserializeJson(json, stream);
+}
+
+// ---- ESPConfigEepromStorage ----
+
+// The segment table at the start of the EEPROM area holds the segment magic,
+// the number of segments and the name, offset and size of each segment. A
+// segment is allocated after the last one the first time its name is used.
+ESPConfigEepromStorage::ESPConfigEepromStorage(
+    const ESPConfig::segment_t& segment)
+    : m_offset{0}, m_length{0} {
+  struct entry_t {
+    char name[12];
+    uint16_t offset;
+    uint16_t size;
+  };
+  struct table_t {
+    uint32_t magic;
+    uint32_t count;
+    entry_t entry[m_segmentCount];
+  } table;
+
+  // a longer name would be cut when stored and never match again
+  if (!segment.name || strlen(segment.name) >= sizeof(entry_t::name)) {
+    Serial.printf_P(PSTR("ESPConfig segment error: the segment name '%s' is "
+                         "longer than %d characters\n"),
+                    segment.name ? segment.name : "",
+                    sizeof(entry_t::name) - 1);
+    return;
+  }
+
+  EEPROM.begin(m_eepromSize);
+  EEPROM.get(0, table);
+  if (table.magic != m_segmentMagic || table.count > m_segmentCount) {
+    if (holdsConfig()) {
+      Serial.printf_P(PSTR("ESPConfig segment error: the EEPROM area holds a "
+                           "config saved without segments, it is not "
+                           "overwritten by the segment table and segment "
+                           "'%s' is not opened\n"),
+                      segment.name);
+      EEPROM.end();
+      return;
+    }
+    table = {m_segmentMagic, 0, {}};
+  }
+
+  auto found{std::find_if(table.entry, table.entry + table.count,
+                          [&segment](const entry_t& entry) {
+                            return strncmp(entry.name, segment.name,
+                                           sizeof(entry.name)) == 0;
+                          })};
+  if (found == table.entry + table.count) {
+    auto offset{table.count ? found[-1].offset + found[-1].size
+                            : (uint32_t)sizeof(table)};
+    if (table.count == m_segmentCount ||
+        offset + segment.size > m_eepromSize) {
+      Serial.printf_P(PSTR("ESPConfig segment error: no room for segment "
+                           "'%s' of %d bytes\n"),
+                      segment.name, segment.size);
+      EEPROM.end();
+      return;
+    }
+    strncpy(found->name, segment.name, sizeof(found->name) - 1);
+    found->name[sizeof(found->name) - 1] = '\0';
+    found->offset = offset;
+    found->size = segment.size;
+    table.count++;
+    EEPROM.put(0, table);
+    EEPROM.write(found->offset, 0);  // the segment holds no config yet
+#if ESPCONFIG_STATS
+    ++stats().eepromCommits;
+#endif
+  } else if (found->size != segment.size) {
+    Serial.printf_P(PSTR("ESPConfig segment warning: segment '%s' keeps its "
+                         "size of %d bytes\n"),
+                    segment.name, found->size);
+  }
+  EEPROM.end();
+
+  m_offset = found->offset;
+  m_length = found->size;
+}
+
+// a config saved over the whole area, called between EEPROM.begin() and
+// EEPROM.end(). One too large for the document is taken as a config too.
+bool ESPConfigEepromStorage::holdsConfig() {
+  DynamicJsonDocument json{m_jsonDocSize};
+  EepromStream eepromStream(0, m_eepromSize);
+  auto error{parse(json, eepromStream)};
+  return error == DeserializationError::NoMemory ||
+         (!error && json[ESPCONFIG_SAVEDKEY].as<bool>());
+}
+
+void ESPConfigEepromStorage::read(ESPConfig& config) {
+  if (m_length == 0) {
+    return;
+  }
+
+  DynamicJsonDocument json{m_jsonDocSize};
+  EEPROM.begin(m_eepromSize);
+  EepromStream eepromStream(m_offset, m_length);
+  auto error{deserialize(json, eepromStream)};
+  eepromStream.flush();
+  EEPROM.end();
+
+  if (!error && json[ESPCONFIG_SAVEDKEY].as<bool>()) {
+    readJson(config, json.as<JsonObject>());
+  }
+}
+
+void ESPConfigEepromStorage::save(const ESPConfig& config) {
+  if (m_length == 0) {
+    Serial.printf_P(PSTR("ESPConfig save error: the EEPROM segment could not "
+                         "be opened and the config data was not saved\n"));
+    return;
+  }
+
+  auto json{toJSONObj(config)};
+#if ESPCONFIG_COMPRESS
+  std::string raw;
+  serializeJson(json, raw);
+  auto data{ESPConfigLZSS::compress(raw)};
+  if (data.empty()) {
+    data = std::move(raw);  // too long for the header, saved as plain JSON
+  }
+  auto toWrite{data.size()};
+#else
+  auto toWrite{measureJson(json)};
+#endif
+  if (toWrite > m_length) {
+    Serial.printf_P(
+        PSTR("ESPConfig save error: the config data size %d is greater than "
+             "the available EEPROM size %d and the config data was not "
+             "saved.\n"
+             "Please increase the available EEPROM size using the "
+             "ESPCONFIG_EEPROMSIZE macro identifier or the segment "
+             "size.\n"),
+        toWrite, m_length);
+    return;
+  }
+
+  EEPROM.begin(m_eepromSize);
+  EepromStream eepromStream(m_offset, m_length);
+#if ESPCONFIG_COMPRESS
+  eepromStream.write((const uint8_t*)data.data(), data.size());
+#else
+  serializeJson(json, eepromStream);
+#endif
+  eepromStream.flush();
+  EEPROM.end();
+#if ESPCONFIG_STATS
+  ++stats().eepromCommits;
+  stats().saveBytes += toWrite;
+#endif
+  clean(config);
+}
+
+// ---- ESPConfigFileStorage ----
+
+void ESPConfigFileStorage::read(ESPConfig& config) {
+  if (!m_fileSys) {
+    return;
+  }
+
+#if ESPCONFIG_CACHE
+  closeCache();
+#endif
+  m_mountCB(m_fileSys);
+#if ESPCONFIG_CACHE
+  auto signature{sourceSignature()};
+  if (!readCache(config, signature)) {
+    ESPConfig files{JsonObjectConst{}};
+    readFiles(files);
+    writeCache(config, signature, files);
+  }
+#else
+  readFiles(config);
+#endif
+  unmount();
+}
+
+// the file system stays mounted while the cache file is open for the pagers
+void ESPConfigFileStorage::unmount() {
+#if ESPCONFIG_CACHE
+  if (m_cacheFile) {
+    return;
+  }
+#endif
+  m_unmountCB(m_fileSys);
+}
+
+// The files are merged last to first so the first file overrides the others.
+// With parallel set the files are parsed a batch at a time, one on this thread
+// and the rest on their own threads, and merged in order once all are parsed.
+void ESPConfigFileStorage::readFiles(ESPConfig& config) const {
+  std::vector<const char*> files{m_configFileList.rbegin(),
+                                 m_configFileList.rend()};
+#if ESPCONFIG_PARALLEL > 1
+  auto batch{std::max<size_t>(1, std::min<size_t>(m_parallel, files.size()))};
+#else
+  size_t batch{1};
+#endif
+  std::vector<layer_t> layers{};
+  layers.reserve(batch);
+  while (layers.size() < batch) {
+    layers.emplace_back(m_jsonDocSize);
+  }
+
+#if ESPCONFIG_PARALLEL > 1 && defined(ESP32)
+  esp_pthread_cfg_t previous;
+  auto restore{esp_pthread_get_cfg(&previous) == ESP_OK};
+  auto threadCfg{esp_pthread_get_default_config()};
+  threadCfg.stack_size = ESPCONFIG_PARALLELSTACK;
+  esp_pthread_set_cfg(&threadCfg);
+#endif
+  for (size_t first{0}; first < files.size(); first += batch) {
+    auto count{std::min(batch, files.size() - first)};
+#if ESPCONFIG_PARALLEL > 1
+    std::vector<std::thread> threads{};
+    for (size_t i{1}; i < count; i++) {
+      threads.emplace_back([this, &layers, &files, first, i] {
+        parseFile(layers[i], files[first + i]);
+      });
+    }
+    parseFile(layers[0], files[first]);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+#else
+    parseFile(layers[0], files[first]);
+#endif
+    for (size_t i{0}; i < count; i++) {
+      if (parsed(layers[i], files[first + i])) {
+        readJson(config, layers[i].json.as<JsonObject>());
+      }
+    }
+  }
+#if ESPCONFIG_PARALLEL > 1 && defined(ESP32)
+  if (!restore) {
+    previous = esp_pthread_get_default_config();
+  }
+  esp_pthread_set_cfg(&previous);
+#endif
+}
+
+// runs on the parsing threads, errors are reported by parsed()
+void ESPConfigFileStorage::parseFile(layer_t& layer,
+                                     const char* fileName) const {
+  auto configFile = m_fileSys->open(fileName, "r");
+  layer.opened = (bool)configFile;
+  if (layer.opened) {
+    layer.error = parse(layer.json, configFile);
+    configFile.close();
+  }
+}
+
+bool ESPConfigFileStorage::parsed(const layer_t& layer, const char* fileName) {
+  if (!layer.opened) {
+    Serial.printf_P(PSTR("ESPConfig read warning: unable to open "
+                         "config file '%s' for read\n"),
+                    fileName);
+    return false;
+  }
+#if ESPCONFIG_STATS
+  stats().overflows += layer.error == DeserializationError::NoMemory;
+#endif
+  if (layer.error) {
+    Serial.printf_P(PSTR("ESPConfig read error: config file "
+                         "serializeJson() failed: %s\n"),
+                    layer.error.c_str());
+    return false;
+  }
+  return true;
+}
+
+#if ESPCONFIG_CACHE
+// FNV-1a over the name, size, time stamp and optionally the content of each
+// configuration file
+uint32_t ESPConfigFileStorage::sourceSignature() const {
+  uint32_t hash{2166136261u};
+  auto fnv1a{[&hash](const void* data, size_t len) {
+    for (auto byte{(const uint8_t*)data}; len--; byte++) {
+      hash = (hash ^ *byte) * 16777619u;
+    }
+  }};
+
+  fnv1a(&ESPConfigImage::version, sizeof(ESPConfigImage::version));
+  for (auto fileName : m_configFileList) {
+    fnv1a(fileName, strlen(fileName) + 1);
+    auto configFile = m_fileSys->open(fileName, "r");
+    if (!configFile) {
+      continue;
+    }
+    auto size{(uint32_t)configFile.size()};
+    auto lastWrite{configFile.getLastWrite()};
+    fnv1a(&size, sizeof(size));
+    fnv1a(&lastWrite, sizeof(lastWrite));
+  #if ESPCONFIG_CACHEHASH
+    uint8_t buffer[64];
+    while (auto len{configFile.read(buffer, sizeof(buffer))}) {
+      fnv1a(buffer, len);
+    }
+  #endif
+    configFile.close();
+  }
+  return hash;
+}
+
+std::string ESPConfigFileStorage::cacheFileName() const {
+  return std::string{m_configFileList.at(0)} + ESPCONFIG_CACHESUFFIX;
+}
+
+// The cache file holds the cache magic, the source signature, the number of
+// image bytes read into RAM and the image. The top level arrays placed after
+// that by ESPConfigImage::build are read from the file when they are used.
+bool ESPConfigFileStorage::readCache(ESPConfig& config, uint32_t signature) {
+  auto cacheFile = m_fileSys->open(cacheFileName().c_str(), "r");
+  if (!cacheFile) {
+    return false;
+  }
+
+  uint32_t header[3]{};
+  auto size{cacheFile.size() - sizeof(header)};
+  std::unique_ptr<uint8_t[]> data{};
+  auto valid{cacheFile.read((uint8_t*)header, sizeof(header)) ==
+                 sizeof(header) &&
+             header[0] == m_cacheMagic && header[1] == signature &&
+             header[2] <= size};
+  if (valid) {
+    data.reset(new uint8_t[header[2]]);
+    valid = cacheFile.read(data.get(), header[2]) == header[2];
+  }
+  cacheFile.close();
+  if (!valid) {
+    return false;
+  }
+
+  // the image only refers past the resident bytes for the arrays left behind
+  ESPConfigImage image{data.get(), size, header[2]};
+  if (!image) {
+    return false;
+  }
+  readCached(config, image, signature, header[2]);
+  return true;
+}
+
+// read an image, deferring the arrays left in the cache file. The pagers read
+// the cache file opened here, a pager of an earlier read fails once the file
+// was opened again for another signature.
+void ESPConfigFileStorage::readCached(ESPConfig& config,
+                                      const ESPConfigImage& image,
+                                      uint32_t signature, uint32_t resident) {
+  readImage(config, image, resident);
+  m_paged.clear();
+  image.forEach(image.root(), [&](const ESPConfigImage::entry_t& entry) {
+    if (entry.type < 5 || entry.type > 7 || entry.value < resident) {
+      return;
+    }
+    auto offset{(uint32_t)(3 * sizeof(uint32_t)) + entry.value};
+    auto key{image.key(entry)};
+    m_paged[key] = {
+        [this, offset, signature](uint32_t at, uint8_t* data, size_t size) {
+          auto valid{m_cacheFile && m_cacheSignature == signature &&
+                     m_cacheFile.seek(offset + at) &&
+                     m_cacheFile.read(data, size) == size};
+          if (!valid) {
+            Serial.printf_P(PSTR("ESPConfig read error: unable to read the "
+                                 "cache file '%s'\n"),
+                            cacheFileName().c_str());
+          }
+          return valid;
+        },
+        entry.type, entry.count};
+    defer(config, key.c_str());
+  });
+
+  if (!m_paged.empty()) {
+    m_cacheFile = m_fileSys->open(cacheFileName().c_str(), "r");
+    m_cacheSignature = signature;
+  }
+}
+
+ESPConfigFileStorage::~ESPConfigFileStorage() {
+  closeCache();
+}
+
+void ESPConfigFileStorage::closeCache() {
+  if (m_cacheFile) {
+    m_cacheFile.close();
+    m_unmountCB(m_fileSys);
+  }
+}
+
+bool ESPConfigFileStorage::readKey(ESPConfig& config, const char* key) {
+  auto found{m_paged.find(key)};
+  if (found == m_paged.end()) {
+    return false;
+  }
+  readPaged(config, key, found->second);
+  return true;
+}
+
+bool ESPConfigFileStorage::pages(const char* key,
+                                 ESPConfigPager::source_t& source) {
+  auto found{m_paged.find(key)};
+  if (found == m_paged.end()) {
+    return false;
+  }
+  source = found->second;
+  return true;
+}
+
+void ESPConfigFileStorage::writeCache(ESPConfig& config, uint32_t signature,
+                                      const ESPConfig& files) {
+  auto data{ESPConfigImage::build(files, m_pagedArray)};
+  ESPConfigImage image{(const uint8_t*)data.data(), data.size()};
+
+  // the arrays placed last by build() start the part left in the file
+  uint32_t resident{(uint32_t)data.size()};
+  if (m_pagedArray != 0) {
+    image.forEach(image.root(),
+                  [&resident](const ESPConfigImage::entry_t& entry) {
+                    if (entry.type >= 5 && entry.type <= 7 &&
+                        entry.count >= m_pagedArray) {
+                      resident = std::min(resident, entry.value);
+                    }
+                  });
+  }
+
+  auto cacheFile = m_fileSys->open(cacheFileName().c_str(), "w");
+  if (!cacheFile) {
+    Serial.printf_P(PSTR("ESPConfig cache error: unable to open cache file "
+                         "'%s' for write\n"),
+                    cacheFileName().c_str());
+    readImage(config, image);
+    return;
+  }
+  const uint32_t header[3]{m_cacheMagic, signature, resident};
+  auto written{cacheFile.write((const uint8_t*)header, sizeof(header)) +
+               cacheFile.write((const uint8_t*)data.data(), data.size())};
+  cacheFile.close();
+  if (written != sizeof(header) + data.size()) {
+    Serial.printf_P(PSTR("ESPConfig cache error: file system write failed, "
+                         "%d bytes written not %d\n"),
+                    written, sizeof(header) + data.size());
+    m_fileSys->remove(cacheFileName().c_str());
+    readImage(config, image);
+    return;
+  }
+  readCached(config, image, signature, resident);
+}
+#endif
+
+void ESPConfigFileStorage::save(const ESPConfig& config) {
+  if (!m_fileSys) {
+    return;
+  }
+
+  // write configuration json to FS
+  if (m_configFileList.empty()) {
+    Serial.printf_P(PSTR("ESPConfig save error: no config file provided\n"));
+    return;
+  }
+
+  // the data is ready before the file is opened, which truncates it
+  auto json{toJSONObj(config)};
+#if ESPCONFIG_COMPRESS
+  std::string data;
+  serializeJson(json, data);
+  auto compressed{ESPConfigLZSS::compress(data)};
+  if (!compressed.empty()) {
+    data = std::move(compressed);  // else too long for the header, plain JSON
+  }
+#endif
+
+  m_mountCB(m_fileSys);
+  auto configFile = m_fileSys->open(m_configFileList.at(0), "w");
+  if (configFile) {
+#if ESPCONFIG_COMPRESS
+    auto toWrite{data.size()};
+    auto written{configFile.write((const uint8_t*)data.data(), data.size())};
+#else
+    auto toWrite{measureJsonPretty(json)};
+    auto written{serializeJsonPretty(json, configFile)};
+#endif
+    configFile.close();
+#if ESPCONFIG_STATS
+    stats().saveBytes += written;
+#endif
+    if (written != toWrite) {
+      Serial.printf_P(
+          PSTR("ESPConfig save error: file system write failed, %d "
+               "bytes written not %d\n"),
+          written, toWrite);
+    } else {
+      clean(config);
+    }
+  } else {
+    Serial.printf_P(PSTR("ESPConfig save error: unable to open config file "
+                         "'%s' for write\n"),
+                    m_configFileList[0]);
+  }
+  unmount();
+}
+
+// ---- ESPConfigRecordStorage ----
+
+namespace {
+// the longest Preferences key, longer config keys are hashed
+constexpr size_t m_recordNameLength{15};
+const char m_indexRecord[]{"~keys"};
+}  // namespace
+
+ESPConfigRecordStorage::ESPConfigRecordStorage(
+    const char* name, ESPConfig::fileSystem_t fileSys, const bool lazy)
+    : m_name{name ? name : ""},
+      m_fileSys{fileSys},
+      m_lazy{lazy},
+      m_valid{validName(m_name, fileSys)} {}
+
+// the name is a single directory below the root, or a Preferences namespace
+bool ESPConfigRecordStorage::validName(const std::string& name,
+                                       ESPConfig::fileSystem_t fileSys) {
+  auto valid{!name.empty() && name != "." && name != ".." &&
+             name.find('/') == std::string::npos};
+#if defined(ESP32)
+  valid = valid && (fileSys || name.size() <= m_recordNameLength);
+#endif
+  if (!valid) {
+    Serial.printf_P(PSTR("ESPConfig storage error: '%s' is not a valid "
+                         "record storage name, the records are neither read "
+                         "nor saved\n"),
+                    name.c_str());
+  }
+  return valid;
+}
+
+std::string ESPConfigRecordStorage::recordName(const char* key) {
+  if (strlen(key) <= m_recordNameLength && key[0] != '~') {
+    return key;
+  }
+  uint32_t hash{2166136261u};
+  for (auto byte{(const uint8_t*)key}; *byte; byte++) {
+    hash = (hash ^ *byte) * 16777619u;
+  }
+  char name[10];
+  snprintf(name, sizeof(name), "~%08x", hash);
+  return name;
+}
+
+std::string ESPConfigRecordStorage::recordPath(
+    const std::string& record) const {
+  return "/" + m_name + "/" + record;
+}
+
+bool ESPConfigRecordStorage::begin(const bool readOnly) {
+  if (!m_valid) {
+    return false;
+  }
+  if (m_fileSys) {
+    if (!readOnly) {
+      m_fileSys->mkdir(("/" + m_name).c_str());
+    }
+    return true;
+  }
+#if defined(ESP32)
+  return m_preferences.begin(m_name.c_str(), readOnly);
+#else
+  return true;
+#endif
+}
+
+void ESPConfigRecordStorage::end() {
+#if defined(ESP32)
+  if (!m_fileSys) {
+    m_preferences.end();
+  }
+#endif
+}
+
+bool ESPConfigRecordStorage::readRecord(const std::string& record,
+                                        DynamicJsonDocument& json) {
+  if (m_fileSys) {
+    auto recordFile = m_fileSys->open(recordPath(record).c_str(), "r");
+    if (!recordFile) {
+      return false;
+    }
+    auto error{deserializeMsgPack(json, recordFile)};
+    recordFile.close();
+    return !error;
+  }
+#if defined(ESP32)
+  switch (m_preferences.getType(record.c_str())) {
+    case PT_U8:
+      return json.set(m_preferences.getBool(record.c_str()));
+    case PT_I32:
+      return json.set(m_preferences.getInt(record.c_str()));
+    case PT_STR:
+      return json.set(m_preferences.getString(record.c_str()));
+    case PT_BLOB: {
+      std::string data(m_preferences.getBytesLength(record.c_str()), '\0');
+      m_preferences.getBytes(record.c_str(), &data[0], data.size());
+      return !deserializeMsgPack(json, data);
+    }
+    default:
+      return false;
+  }
+#else
+  auto found{m_records.find(record)};
+  return found != m_records.end() && !deserializeMsgPack(json, found->second);
+#endif
+}
+
+bool ESPConfigRecordStorage::writeRecord(const std::string& record,
+                                         JsonVariantConst value) {
+  std::string data;
+  serializeMsgPack(value, data);
+#if ESPCONFIG_STATS
+  stats().saveBytes += data.size();
+#endif
+  if (m_fileSys) {
+    auto recordFile = m_fileSys->open(recordPath(record).c_str(), "w");
+    if (!recordFile) {
+      return false;
+    }
+    auto written{recordFile.write((const uint8_t*)data.data(), data.size())};
+    recordFile.close();
+    return written == data.size();
+  }
+#if defined(ESP32)
+  auto name{record.c_str()};
+  auto type{value.is<bool>()          ? PT_U8
+            : value.is<int32_t>()     ? PT_I32
+            : value.is<const char*>() ? PT_STR
+                                      : PT_BLOB};
+  // a record keeps its type, so a key changing type is written anew
+  if (m_preferences.getType(name) != type) {
+    m_preferences.remove(name);
+  }
+  switch (type) {
+    case PT_U8:
+      return m_preferences.putBool(name, value.as<bool>()) != 0;
+    case PT_I32:
+      return m_preferences.putInt(name, value.as<int32_t>()) != 0;
+    case PT_STR:
+      return m_preferences.putString(name, value.as<const char*>()) != 0;
+    default:
+      return m_preferences.putBytes(name, data.data(), data.size()) ==
+             data.size();
+  }
+#else
+  m_records[record] = std::move(data);
+  return true;
+#endif
+}
+
+void ESPConfigRecordStorage::removeRecord(const std::string& record) {
+  if (m_fileSys) {
+    m_fileSys->remove(recordPath(record).c_str());
+    return;
+  }
+#if defined(ESP32)
+  m_preferences.remove(record.c_str());
+#else
+  m_records.erase(record);
+#endif
+}
+
+// the index record lists the keys, their values are read now or when each
+// key is first used
+void ESPConfigRecordStorage::read(ESPConfig& config) {
+  DynamicJsonDocument json{m_jsonDocSize};
+  if (!begin(true)) {
+    return;
+  }
+  auto found{readRecord(m_indexRecord, json)};
+  end();
+  if (!found) {
+    return;
+  }
+
+  m_index.clear();
+  for (auto key : json.as<JsonArrayConst>()) {
+    m_index.emplace(key.as<const char*>());
+  }
+  for (const auto& key : m_index) {
+    if (m_lazy) {
+      defer(config, key.c_str());
+    } else {
+      readKey(config, key.c_str());
+    }
+  }
+}
+
+bool ESPConfigRecordStorage::readKey(ESPConfig& config, const char* key) {
+  DynamicJsonDocument json{m_jsonDocSize};
+  if (!begin(true)) {
+    return false;
+  }
+  auto found{readRecord(recordName(key), json)};
+  end();
+  if (!found) {
+    Serial.printf_P(PSTR("ESPConfig read warning: no record for key '%s'\n"),
+                    key);
+    return false;
+  }
+  readValue(config, key, json.as<JsonVariantConst>());
+  return true;
+}
+
+// write the records of the dirty keys, then the index if the keys changed
+void ESPConfigRecordStorage::save(const ESPConfig& config) {
+  DynamicJsonDocument json{m_jsonDocSize};
+  std::vector<std::string> removed;
+  writeDirty(config, json.to<JsonObject>(), removed);
+  if (json.overflowed()) {
+#if ESPCONFIG_STATS
+    ++stats().overflows;
+#endif
+    Serial.printf_P(PSTR("ESPConfig save error: the changed keys do not fit "
+                         "in ESPCONFIG_JSONDOCSIZE and were not saved\n"));
+    return;
+  }
+  if (!begin(false)) {
+    Serial.printf_P(PSTR("ESPConfig save error: unable to open the records "
+                         "'%s'\n"),
+                    m_name.c_str());
+    return;
+  }
+
+  auto saved{true};
+  auto indexChanged{false};
+  for (auto kv : json.as<JsonObjectConst>()) {
+    auto key{kv.key().c_str()};
+    if (!writeRecord(recordName(key), kv.value())) {
+      Serial.printf_P(PSTR("ESPConfig save error: unable to write the record "
+                           "for key '%s'\n"),
+                      key);
+      saved = false;
+      continue;
+    }
+    indexChanged |= m_index.emplace(key).second;
+  }
+  for (const auto& key : removed) {
+    removeRecord(recordName(key.c_str()));
+    indexChanged |= m_index.erase(key) != 0;
+  }
+
+  if (indexChanged) {
+    DynamicJsonDocument index{m_jsonDocSize};
+    auto keys{index.to<JsonArray>()};
+    for (const auto& key : m_index) {
+      keys.add(key.c_str());
+    }
+    saved &= writeRecord(m_indexRecord, index.as<JsonVariantConst>());
+  }
+  end();
+
+  if (saved) {
+    clean(config);
+  }
+}
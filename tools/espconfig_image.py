@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Generate an ESPConfig config image from a JSON file.
+
+The image layout is described in include/ESPConfigImage.hpp. Arrays and
+values follow the rules used by ESPConfig::readJson, the type of an array is
+taken from its first element and empty arrays and nulls are skipped.
+
+Command line:
+    espconfig_image.py defaults.json defaults.h [--name configDefaults]
+    espconfig_image.py defaults.json defaults.bin --binary
+
+PlatformIO, in platformio.ini:
+    extra_scripts = pre:.pio/libdeps/<env>/ESPConfig/tools/espconfig_image.py
+    custom_espconfig_defaults = data/defaults.json
+    custom_espconfig_header = include/ESPConfigDefaults.h
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+MAGIC = 0x47464345  # "ECFG"
+VERSION = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 16
+
+# the index of each type in the Supported Value Types table
+BOOL, INT32, DOUBLE, STRING, OBJECT = 0, 1, 2, 3, 4
+BOOL_ARRAY, INT32_ARRAY, DOUBLE_ARRAY, STRING_ARRAY, OBJECT_ARRAY = 5, 6, 7, 8, 9
+
+
+def strip_comments(text):
+    """Remove // and /* */ comments outside of strings, as ArduinoJson does."""
+    pattern = re.compile(r'("(?:\\.|[^"\\])*")|//[^\n]*|/\*.*?\*/', re.DOTALL)
+    return pattern.sub(lambda m: m.group(1) or "", text)
+
+
+def is_int32(value):
+    return (isinstance(value, int) and not isinstance(value, bool)
+            and -2**31 <= value < 2**31)
+
+
+def is_number(value):
+    return isinstance(value, (int, float)) and not isinstance(value, bool)
+
+
+class ImageWriter:
+    def __init__(self):
+        self.data = bytearray(HEADER_SIZE)
+        self.strings = {}
+
+    def align(self, size):
+        while len(self.data) % size:
+            self.data.append(0)
+
+    def append(self, raw, alignment=4):
+        self.align(alignment)
+        offset = len(self.data)
+        self.data += raw
+        return offset
+
+    def string(self, text):
+        if text not in self.strings:
+            self.strings[text] = self.append(text.encode("utf-8") + b"\0", 1)
+        return self.strings[text]
+
+    def entry(self, value):
+        """Return (type, count, value) for a JSON value, None to skip it."""
+        if isinstance(value, bool):
+            return BOOL, 0, int(value)
+        if is_int32(value):
+            return INT32, 0, value & 0xFFFFFFFF
+        if is_number(value):
+            return DOUBLE, 0, self.append(struct.pack("<d", value), 8)
+        if isinstance(value, str):
+            return STRING, len(value.encode("utf-8")), self.string(value)
+        if isinstance(value, dict):
+            return OBJECT, 0, self.node(value)
+        if isinstance(value, list) and value:
+            first = value[0]
+            count = len(value)
+            if isinstance(first, bool):
+                return BOOL_ARRAY, count, self.append(
+                    bytes(bool(v) for v in value), 1)
+            if is_int32(first):
+                return INT32_ARRAY, count, self.append(
+                    struct.pack("<%di" % count, *(int(v) for v in value)))
+            if is_number(first):
+                return DOUBLE_ARRAY, count, self.append(
+                    struct.pack("<%dd" % count, *(float(v) for v in value)), 8)
+            if isinstance(first, str):
+                offsets = [self.string(v if isinstance(v, str) else "")
+                           for v in value]
+                return STRING_ARRAY, count, self.append(
+                    struct.pack("<%dI" % count, *offsets))
+            if isinstance(first, dict):
+                offsets = [self.node(v if isinstance(v, dict) else {})
+                           for v in value]
+                return OBJECT_ARRAY, count, self.append(
+                    struct.pack("<%dI" % count, *offsets))
+        return None
+
+    def node(self, obj):
+        entries = []
+        for key in sorted(obj, key=lambda k: k.encode("utf-8")):
+            entry = self.entry(obj[key])
+            if entry is not None:
+                entries.append((self.string(key),) + entry)
+        raw = struct.pack("<I", len(entries))
+        for key, kind, count, value in entries:
+            raw += struct.pack("<IB3xII", key, kind, count, value)
+        return self.append(raw)
+
+    def image(self, obj):
+        root = self.node(obj)
+        self.align(4)
+        struct.pack_into("<IHHII", self.data, 0, MAGIC, VERSION, 0,
+                         len(self.data), root)
+        return bytes(self.data)
+
+
+def build_image(json_text):
+    return ImageWriter().image(json.loads(strip_comments(json_text)))
+
+
+def to_header(image, name, source):
+    lines = [
+        "#pragma once",
+        "",
+        "// generated by tools/espconfig_image.py from %s, do not edit" % source,
+        "",
+        "#include <Arduino.h>",
+        "",
+        "alignas(8) const uint8_t %s[] PROGMEM = {" % name,
+    ]
+    for i in range(0, len(image), 12):
+        lines.append("  " + ", ".join("0x%02x" % b for b in image[i:i + 12]) + ",")
+    lines += ["};", "constexpr size_t %sSize{%d};" % (name, len(image)), ""]
+    return "\n".join(lines)
+
+
+def generate(source, output, name, binary):
+    with open(source, encoding="utf-8") as src:
+        image = build_image(src.read())
+    if binary:
+        with open(output, "wb") as out:
+            out.write(image)
+    else:
+        with open(output, "w", encoding="utf-8") as out:
+            out.write(to_header(image, name, source))
+    return len(image)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="the JSON file")
+    parser.add_argument("output", help="the header or binary image to write")
+    parser.add_argument("--name", default="configDefaults",
+                        help="the name of the generated array")
+    parser.add_argument("--binary", action="store_true",
+                        help="write the raw image instead of a header")
+    args = parser.parse_args(argv)
+    size = generate(args.source, args.output, args.name, args.binary)
+    print("ESPConfig image: %s -> %s, %d bytes" % (args.source, args.output, size))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
+else:
+    try:
+        Import("env")  # noqa: F821, only defined when run by PlatformIO
+        source = env.GetProjectOption("custom_espconfig_defaults", "")  # noqa: F821
+        if source:
+            header = env.GetProjectOption(  # noqa: F821
+                "custom_espconfig_header", "include/ESPConfigDefaults.h")
+            generate(source, header, "configDefaults", False)
+    except NameError:
+        pass
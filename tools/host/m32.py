@@ -0,0 +1,4 @@
+# link the 32 bit build of the host tool, build_flags only reach the compiler
+Import("env")
+
+env.Append(LINKFLAGS=["-m32"])
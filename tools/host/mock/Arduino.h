@@ -0,0 +1,111 @@
+#pragma once
+
+// The parts of the Arduino core used by ESPConfig and ArduinoJson, so the
+// library builds unchanged on a host. Flash is ordinary memory here.
+
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class __FlashStringHelper;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_double(addr) (*(const double*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+inline void* memcpy_P(void* dest, const void* src, size_t n) {
+  return memcpy(dest, src, n);
+}
+inline size_t strlen_P(const char* str) { return strlen(str); }
+inline int strcmp_P(const char* a, const char* b) { return strcmp(a, b); }
+inline int strncmp_P(const char* a, const char* b, size_t n) {
+  return strncmp(a, b, n);
+}
+
+namespace espconfig_mock {
+inline std::chrono::steady_clock::time_point start() {
+  static const auto start{std::chrono::steady_clock::now()};
+  return start;
+}
+}  // namespace espconfig_mock
+
+inline unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - espconfig_mock::start())
+      .count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+inline void yield() {}
+inline void delay(unsigned long) {}
+
+class Print {
+  public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+      size_t written{0};
+      while (size-- && write(*buffer++)) {
+        written++;
+      }
+      return written;
+    }
+    size_t write(const char* str) {
+      return write((const uint8_t*)str, strlen(str));
+    }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buffer, size_t length) {
+      size_t count{0};
+      for (int c; count < length && (c = read()) >= 0; count++) {
+        buffer[count] = (char)c;
+      }
+      return count;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) {
+      return readBytes((char*)buffer, length);
+    }
+    void setTimeout(unsigned long) {}
+};
+
+// messages go to stderr, so the output of a tool can be piped
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long) {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override { return fputc(c, stderr) != EOF; }
+    size_t printf(const char* format, ...) {
+      va_list args;
+      va_start(args, format);
+      auto len{vfprintf(stderr, format, args)};
+      va_end(args);
+      return len < 0 ? 0 : len;
+    }
+    size_t printf_P(const char* format, ...) {
+      va_list args;
+      va_start(args, format);
+      auto len{vfprintf(stderr, format, args)};
+      va_end(args);
+      return len < 0 ? 0 : len;
+    }
+};
+
+inline HardwareSerial Serial;
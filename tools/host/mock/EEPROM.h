@@ -0,0 +1,52 @@
+#pragma once
+
+// The ESP8266 and ESP32 EEPROM class, holding the emulated area in RAM.
+// begin() grows the area erased to 0xff and keeps what it already holds, so
+// a dump loaded with data() is read by the next begin().
+
+#include <Arduino.h>
+
+#include <vector>
+
+class EEPROMClass {
+  public:
+    void begin(size_t size) {
+      if (m_data.size() < size) {
+        m_data.resize(size, 0xff);
+      }
+    }
+    bool end() { return commit(); }
+    bool commit() {
+      ++m_commits;
+      return true;
+    }
+
+    uint8_t read(int address) const { return m_data.at(address); }
+    void write(int address, uint8_t value) { m_data.at(address) = value; }
+    uint8_t* getDataPtr() { return m_data.data(); }
+    size_t length() const { return m_data.size(); }
+
+    template <typename T>
+    T& get(int address, T& value) const {
+      m_data.at(address + sizeof(T) - 1);  // throws past the end of the area
+      memcpy(&value, &m_data[address], sizeof(T));
+      return value;
+    }
+
+    template <typename T>
+    const T& put(int address, const T& value) {
+      m_data.at(address + sizeof(T) - 1);
+      memcpy(&m_data[address], &value, sizeof(T));
+      return value;
+    }
+
+    // host access to the area and the commits made
+    std::vector<uint8_t>& data() { return m_data; }
+    uint32_t commits() const { return m_commits; }
+
+  private:
+    std::vector<uint8_t> m_data;
+    uint32_t m_commits{0};
+};
+
+inline EEPROMClass EEPROM;
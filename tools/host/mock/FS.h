@@ -0,0 +1,120 @@
+#pragma once
+
+// The fs::FS and fs::File classes of the ESP8266 and ESP32 cores over the host
+// file system. With a root a path is taken relative to it, so "/config.json"
+// is a file in that directory, without one paths are used as given.
+
+#include <Arduino.h>
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+  public:
+    File() = default;
+    File(std::FILE* file, const std::string& path)
+        : m_file{file, [](std::FILE* f) { std::fclose(f); }}, m_path{path} {}
+
+    using Stream::readBytes;
+
+    explicit operator bool() const { return (bool)m_file; }
+
+    int available() override {
+      return m_file ? (int)(size() - position()) : 0;
+    }
+    int read() override { return m_file ? std::fgetc(m_file.get()) : -1; }
+    int peek() override {
+      if (!m_file) {
+        return -1;
+      }
+      auto c{std::fgetc(m_file.get())};
+      if (c != EOF) {
+        std::ungetc(c, m_file.get());
+      }
+      return c;
+    }
+    size_t read(uint8_t* buffer, size_t size) {
+      return m_file ? std::fread(buffer, 1, size, m_file.get()) : 0;
+    }
+    size_t readBytes(char* buffer, size_t length) override {
+      return read((uint8_t*)buffer, length);
+    }
+    size_t write(uint8_t c) override {
+      return m_file && std::fputc(c, m_file.get()) != EOF;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+      return m_file ? std::fwrite(buffer, 1, size, m_file.get()) : 0;
+    }
+    void flush() override {
+      if (m_file) {
+        std::fflush(m_file.get());
+      }
+    }
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+      return m_file && std::fseek(m_file.get(), pos, mode) == 0;
+    }
+    size_t position() const {
+      return m_file ? std::ftell(m_file.get()) : 0;
+    }
+    size_t size() const {
+      struct stat st;
+      return m_file && fstat(fileno(m_file.get()), &st) == 0 ? st.st_size : 0;
+    }
+    time_t getLastWrite() const {
+      struct stat st;
+      return stat(m_path.c_str(), &st) == 0 ? st.st_mtime : 0;
+    }
+    const char* name() const { return m_path.c_str(); }
+    void close() { m_file.reset(); }
+
+  private:
+    std::shared_ptr<std::FILE> m_file;
+    std::string m_path;
+};
+
+class FS {
+  public:
+    explicit FS(const std::string& root = "") : m_root{root} {}
+
+    File open(const char* path, const char* mode = "r") {
+      auto name{hostPath(path)};
+      auto file{std::fopen(name.c_str(), mode[0] == 'w'   ? "wb"
+                                         : mode[0] == 'a' ? "ab"
+                                                          : "rb")};
+      return file ? File{file, name} : File{};
+    }
+    bool exists(const char* path) {
+      struct stat st;
+      return stat(hostPath(path).c_str(), &st) == 0;
+    }
+    bool remove(const char* path) {
+      return std::remove(hostPath(path).c_str()) == 0;
+    }
+    bool rename(const char* from, const char* to) {
+      return std::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+    }
+    bool mkdir(const char* path) {
+      return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path);
+    }
+
+  private:
+    std::string hostPath(const char* path) const {
+      return m_root.empty() ? path : m_root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+    const std::string m_root;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,42 @@
+#pragma once
+
+// The EepromStream of StreamUtils, the only part used by ESPConfig, with the
+// commit made by flush() on the ESP8266 and ESP32.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+class EepromStream : public Stream {
+  public:
+    EepromStream(size_t address, size_t size)
+        : m_readAddress{address}, m_writeAddress{address},
+          m_end{address + size} {}
+
+    int available() override { return (int)(m_end - m_readAddress); }
+    int read() override {
+      return m_readAddress < m_end ? EEPROM.read(m_readAddress++) : -1;
+    }
+    int peek() override {
+      return m_readAddress < m_end ? EEPROM.read(m_readAddress) : -1;
+    }
+    size_t write(uint8_t data) override {
+      if (m_writeAddress >= m_end) {
+        return 0;
+      }
+      EEPROM.write(m_writeAddress++, data);
+      return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+      size_t written{0};
+      while (written < size && write(buffer[written])) {
+        written++;
+      }
+      return written;
+    }
+    void flush() override { EEPROM.commit(); }
+
+  private:
+    size_t m_readAddress;
+    size_t m_writeAddress;
+    size_t m_end;
+};
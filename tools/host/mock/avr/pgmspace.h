@@ -0,0 +1,5 @@
+#pragma once
+
+// ArduinoJson includes this for PROGMEM support outside of the Arduino cores
+
+#include <Arduino.h>
@@ -0,0 +1,649 @@
+// Converts and checks ESPConfig configurations on a host. The library is
+// built from src/ against the mock EEPROM and file system in ../mock, so every
+// byte written and every size reported comes from the code that runs on the
+// device, built with the ESPCONFIG_ macros set in platformio.ini.
+//
+//   espconfig convert config.json config.eeprom
+//   espconfig check configs/
+//   espconfig batch configs/ --to msgpack --out build/
+//   espconfig bench cache configs/
+//   espconfig bench keys 1000
+//   espconfig bench parallel configs/
+//
+// The formats are
+//
+//   json     the configuration file written by save()
+//   msgpack  the MessagePack returned by toJSON(ESPConfig::saveFormat::msgPack)
+//   eeprom   the EEPROM area after save() at --offset, ESPCONFIG_EEPROMSIZE
+//            bytes with the rest of the area erased to 0xff
+//   image    the config image the file storage caches, see ESPConfigImage.hpp
+//
+// Every format is read and written, an image through readImage() as the file
+// storage reads its cache. check and batch take files and directories,
+// searched for .json, .msgpack and .eeprom files, and for .bin images with
+// --from image, and exit with 1 when a configuration does not fit. bench times
+// the library code paths named by its first argument on the files given.
+
+#include <ESPConfig.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if !ESPCONFIG_STATS
+# error "build with -DESPCONFIG_STATS=1, the sizes are read from the counters"
+#endif
+
+namespace {
+
+namespace stdfs = std::filesystem;  // fs is the file system of the cores
+
+fs::FS hostFS;
+
+enum class format_t { unknown, json, msgpack, eeprom, image };
+
+struct options_t {
+  format_t from{format_t::unknown};
+  format_t to{format_t::unknown};
+  uint16_t offset{0};
+  uint16_t length{0};
+  std::string out;
+  std::vector<std::string> paths;
+};
+
+const std::map<std::string, format_t> formatNames{
+    {"json", format_t::json},
+    {"msgpack", format_t::msgpack},
+    {"eeprom", format_t::eeprom},
+    {"image", format_t::image},
+};
+
+const std::map<std::string, format_t> extensions{
+    {".json", format_t::json},
+    {".msgpack", format_t::msgpack},
+    {".mpk", format_t::msgpack},
+    {".eeprom", format_t::eeprom},
+    {".bin", format_t::image},
+};
+
+std::string extension(format_t format) {
+  switch (format) {
+    case format_t::json:
+      return ".json";
+    case format_t::msgpack:
+      return ".msgpack";
+    case format_t::eeprom:
+      return ".eeprom";
+    default:
+      return ".bin";
+  }
+}
+
+format_t fileFormat(const std::string& path, format_t given) {
+  if (given != format_t::unknown) {
+    return given;
+  }
+  auto found{extensions.find(stdfs::path{path}.extension().string())};
+  return found != extensions.end() ? found->second : format_t::unknown;
+}
+
+std::string readFile(const std::string& path) {
+  std::ifstream file{path, std::ios::binary};
+  return {std::istreambuf_iterator<char>{file},
+          std::istreambuf_iterator<char>{}};
+}
+
+bool writeFile(const std::string& path, const std::string& data) {
+  std::ofstream file{path, std::ios::binary};
+  file.write(data.data(), data.size());
+  return (bool)file;
+}
+
+// a scratch file for the storages writing to the file system
+std::string scratchFile() {
+  return (stdfs::temp_directory_path() /
+          ("espconfig-" + std::to_string(getpid()) + ".tmp"))
+      .string();
+}
+
+// Reads a file as ESPConfigFileStorage does, JSON or JSON compressed by
+// save(), or as MessagePack. Also reaches the documents save() serializes.
+class hostStorage : public ESPConfigStorage {
+  public:
+    hostStorage(const std::string& path, format_t format, bool& done)
+        : m_path{path}, m_format{format}, m_done{done} {}
+
+    void read(ESPConfig& config) override {
+      auto file{hostFS.open(m_path.c_str(), "r")};
+      if (!file) {
+        Serial.printf_P(PSTR("unable to open '%s'\n"), m_path.c_str());
+        return;
+      }
+      DynamicJsonDocument json{m_jsonDocSize};
+      auto error{m_format == format_t::msgpack
+                     ? deserializeMsgPack(json, file)
+                     : deserialize(json, file)};
+      file.close();
+      if (error) {
+        Serial.printf_P(PSTR("unable to read '%s': %s\n"), m_path.c_str(),
+                        error.c_str());
+        return;
+      }
+      readJson(config, json.as<JsonObject>());
+      m_done = true;
+    }
+    void save(const ESPConfig& config) override {}
+
+    // whether the document built by save() overflows ESPCONFIG_JSONDOCSIZE
+    static bool saveOverflows(const ESPConfig& config) {
+      return toJSONObj(config).overflowed();
+    }
+
+  private:
+    const std::string m_path;
+    const format_t m_format;
+    bool& m_done;
+};
+
+// Reads a config image file as ESPConfigFileStorage reads its cache
+class imageStorage : public ESPConfigStorage {
+  public:
+    explicit imageStorage(const std::string& path) : m_path{path} {}
+
+    void read(ESPConfig& config) override {
+      auto data{readFile(m_path)};
+      readImage(config, ESPConfigImage{(const uint8_t*)data.data(),
+                                       data.size()});
+    }
+    void save(const ESPConfig& config) override {}
+
+  private:
+    const std::string m_path;
+};
+
+// Keeps nothing, a save clears the changes as a successful save does
+class discardStorage : public ESPConfigStorage {
+  public:
+    void read(ESPConfig& config) override {}
+    void save(const ESPConfig& config) override { clean(config); }
+};
+
+std::unique_ptr<ESPConfig> load(const std::string& path, format_t format,
+                                const options_t& options) {
+  auto read{false};
+  std::unique_ptr<ESPConfigStorage> storage;
+  switch (format) {
+    case format_t::json:
+    case format_t::msgpack:
+      storage.reset(new hostStorage{path, format, read});
+      break;
+    case format_t::eeprom: {
+      auto data{readFile(path)};
+      if (data.size() <= options.offset) {
+        Serial.printf_P(PSTR("'%s' ends before offset %u\n"), path.c_str(),
+                        options.offset);
+        return nullptr;
+      }
+      EEPROM.data().assign(data.begin(), data.end());
+      auto length{options.length ? options.length
+                                 : std::min<size_t>(data.size() - options.offset,
+                                                    UINT16_MAX)};
+      storage.reset(new ESPConfigEepromStorage{options.offset,
+                                               (uint16_t)length});
+      break;
+    }
+    case format_t::image:
+      storage.reset(new imageStorage{path});
+      break;
+    default:
+      Serial.printf_P(PSTR("'%s' is not a json, msgpack, eeprom or image "
+                           "file\n"),
+                      path.c_str());
+      return nullptr;
+  }
+
+  ESPConfig::resetStats();
+  std::unique_ptr<ESPConfig> config{new ESPConfig{std::move(storage)}};
+  if (format == format_t::eeprom) {
+    read = config->stats().readBytes != 0;
+    if (!read) {
+      Serial.printf_P(PSTR("'%s' holds no saved configuration at offset %u\n"),
+                      path.c_str(), options.offset);
+    }
+  }
+  if (format == format_t::image) {
+    read = config->stats().readBytes != 0;  // the image error was printed
+  }
+  return read ? std::move(config) : nullptr;
+}
+
+// the bytes written by save() to the storage, counted by the library
+size_t saved(const ESPConfig& config, ESPConfigStorage& storage) {
+  ESPConfig::resetStats();
+  storage.save(config);
+  return config.stats().saveBytes;
+}
+
+// the output of save() to a configuration file
+std::string jsonFile(const ESPConfig& config) {
+  auto name{scratchFile()};
+  ESPConfigFileStorage storage{{name.c_str()}, &hostFS};
+  saved(config, storage);
+  auto data{readFile(name)};
+  stdfs::remove(name);
+  return data;
+}
+
+// the EEPROM area after save(), empty when the config does not fit
+std::string eepromArea(const ESPConfig& config, const options_t& options) {
+  size_t length{options.length ? options.length
+                               : m_eepromSize - options.offset};
+  if (options.offset + length > m_eepromSize) {
+    Serial.printf_P(PSTR("--offset and --length are past the end of the "
+                         "EEPROM area of %u bytes\n"),
+                    (unsigned)m_eepromSize);
+    return {};
+  }
+  EEPROM.data().assign(m_eepromSize, 0xff);
+  ESPConfigEepromStorage storage{options.offset, (uint16_t)length};
+  if (saved(config, storage) == 0) {
+    return {};
+  }
+  return {EEPROM.data().begin(), EEPROM.data().end()};
+}
+
+// the bytes save() writes to the EEPROM, however large the area
+size_t eepromBytes(const ESPConfig& config, const options_t& options) {
+  EEPROM.data().assign(options.offset + UINT16_MAX, 0xff);
+  ESPConfigEepromStorage storage{options.offset, UINT16_MAX};
+  return saved(config, storage);
+}
+
+std::string image(const ESPConfig& config) {
+  return ESPConfigImage::build(config, m_pagedArray);
+}
+
+std::string render(const ESPConfig& config, format_t format,
+                   const options_t& options) {
+  switch (format) {
+    case format_t::json:
+      return jsonFile(config);
+    case format_t::msgpack:
+      return config.toJSON(ESPConfig::saveFormat::msgPack);
+    case format_t::eeprom:
+      return eepromArea(config, options);
+    case format_t::image:
+      return image(config);
+    default:
+      return {};
+  }
+}
+
+// the JsonDocument read() needs for the saved configuration, measured with a
+// document large enough for any configuration
+size_t documentSize(const ESPConfig& config) {
+  auto saved{config.toJSON()};
+  DynamicJsonDocument json{32 * saved.size() + 4096};
+  deserializeJson(json, saved);
+  return json.memoryUsage();
+}
+
+struct file_t {
+  std::string path;
+  std::string output;  // for batch
+};
+
+// the files given and the files found in the directories given, a batch
+// output keeps the path of its file below --out, so a/x.json and b/x.json are
+// written to out/a/x.msgpack and out/b/x.msgpack
+std::vector<file_t> findFiles(const options_t& options, format_t to) {
+  std::vector<file_t> files;
+  auto add{[&](const stdfs::path& file) {
+    auto relative{file.lexically_normal()};
+    if (relative.is_absolute() || *relative.begin() == "..") {
+      relative = stdfs::absolute(file).lexically_normal().relative_path();
+    }
+    auto output{(stdfs::path{options.out} / relative)
+                    .replace_extension(extension(to))};
+    files.push_back({file.string(), output.string()});
+  }};
+
+  for (const auto& path : options.paths) {
+    if (!stdfs::is_directory(path)) {
+      add(path);
+      continue;
+    }
+    std::vector<stdfs::path> found;
+    for (const auto& entry : stdfs::recursive_directory_iterator{path}) {
+      auto format{fileFormat(entry.path().string(), options.from)};
+      if (entry.is_regular_file() && format != format_t::unknown &&
+          (format != format_t::image || options.from == format_t::image)) {
+        found.push_back(entry.path());
+      }
+    }
+    std::sort(found.begin(), found.end());
+    for (const auto& file : found) {
+      add(file);
+    }
+  }
+  return files;
+}
+
+int convert(const options_t& options) {
+  if (options.paths.size() != 2) {
+    return -1;
+  }
+  const auto& source{options.paths[0]};
+  const auto& output{options.paths[1]};
+  auto to{fileFormat(output, options.to)};
+  if (to == format_t::unknown) {
+    Serial.printf_P(PSTR("give the output format with --to\n"));
+    return 2;
+  }
+
+  auto config{load(source, fileFormat(source, options.from), options)};
+  if (!config) {
+    return 1;
+  }
+  auto data{render(*config, to, options)};
+  if (data.empty()) {
+    return 1;
+  }
+  if (!writeFile(output, data)) {
+    Serial.printf_P(PSTR("unable to write '%s'\n"), output.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+int check(const options_t& options) {
+  auto length{options.length ? options.length
+                             : (size_t)m_eepromSize - options.offset};
+  auto result{0};
+  for (const auto& file : findFiles(options, format_t::unknown)) {
+    auto config{load(file.path, fileFormat(file.path, options.from), options)};
+    if (!config) {
+      result = 1;
+      continue;
+    }
+    auto eeprom{eepromBytes(*config, options)};
+    auto document{documentSize(*config)};
+    auto overflows{hostStorage::saveOverflows(*config)};
+    auto fits{eeprom != 0 && eeprom <= length && document <= m_jsonDocSize &&
+              !overflows};
+    printf("%s: %u keys, json %u B, msgpack %u B, image %u B, "
+           "eeprom %u of %u B, document %u of %u B%s%s\n",
+           file.path.c_str(), (unsigned)config->stats().keys,
+           (unsigned)jsonFile(*config).size(),
+           (unsigned)config->toJSON(ESPConfig::saveFormat::msgPack).size(),
+           (unsigned)image(*config).size(), (unsigned)eeprom,
+           (unsigned)length, (unsigned)document, (unsigned)m_jsonDocSize,
+           overflows ? ", save overflows the document" : "",
+           fits ? "" : " - DOES NOT FIT");
+    result |= !fits;
+  }
+  return result;
+}
+
+int batch(const options_t& options) {
+  if (options.to == format_t::unknown || options.out.empty()) {
+    return -1;
+  }
+
+  auto files{findFiles(options, options.to)};
+  std::map<std::string, std::string> outputs;
+  auto collisions{false};
+  for (const auto& file : files) {
+    auto output{stdfs::weakly_canonical(file.output).string()};
+    auto added{outputs.emplace(output, file.path)};
+    if (!added.second ||
+        output == stdfs::weakly_canonical(file.path).string()) {
+      Serial.printf_P(PSTR("'%s' would overwrite '%s'\n"), file.path.c_str(),
+                      added.first->second.c_str());
+      collisions = true;
+    }
+  }
+  if (collisions) {
+    return 2;
+  }
+
+  auto start{micros()};
+  size_t bytes{0}, failed{0};
+  for (const auto& file : files) {
+    auto config{load(file.path, fileFormat(file.path, options.from), options)};
+    auto data{config ? render(*config, options.to, options) : std::string{}};
+    stdfs::create_directories(stdfs::path{file.output}.parent_path());
+    if (data.empty() || !writeFile(file.output, data)) {
+      printf("%s: does not fit or was not converted\n", file.path.c_str());
+      failed++;
+      continue;
+    }
+    bytes += stdfs::file_size(file.path);
+  }
+  auto seconds{std::max(micros() - start, 1ul) / 1e6};
+  printf("%u files, %u failed, %.1f files/s, %.1f KiB/s\n",
+         (unsigned)files.size(), (unsigned)failed, files.size() / seconds,
+         bytes / 1024.0 / seconds);
+  return failed ? 1 : 0;
+}
+
+// the mean microseconds of a call, repeated for at least a quarter second
+template <typename F>
+double timed(F&& call) {
+  auto start{micros()};
+  auto runs{0ul};
+  do {
+    call();
+    runs++;
+  } while (micros() - start < 250000);
+  return (micros() - start) / (double)runs;
+}
+
+// read() of the configuration files against read() of the cache written from
+// them, as ESPConfigFileStorage does with ESPCONFIG_CACHE set
+int benchCache(const options_t& options) {
+  auto cache{scratchFile()};
+  auto result{0};
+  for (const auto& file : findFiles(options, format_t::unknown)) {
+    auto format{fileFormat(file.path, options.from)};
+    auto config{load(file.path, format, options)};
+    if (!config || format == format_t::eeprom || format == format_t::image) {
+      result = 1;
+      continue;
+    }
+    auto parse{timed([&]() { load(file.path, format, options); })};
+    std::string data;
+    auto build{timed([&]() { data = image(*config); })};
+    writeFile(cache, data);
+    auto read{timed([&]() {
+      ESPConfig cached{std::unique_ptr<ESPConfigStorage>{
+          new imageStorage{cache}}};
+    })};
+    printf("%s: %u keys, parse %.1f us, cache %u B written in %.1f us, "
+           "read in %.1f us\n",
+           file.path.c_str(), (unsigned)config->stats().keys, parse,
+           (unsigned)data.size(), build, read);
+#if ESPCONFIG_CACHE
+    // the file storage itself, parsing and writing the cache file on a cold
+    // boot, checking the signature and reading the cache file on a warm one
+    if (format == format_t::json) {
+      writeFile(cache, readFile(file.path));
+      auto cacheName{cache + ESPCONFIG_CACHESUFFIX};
+      auto boot{[&cache]() {
+        ESPConfig booted{std::unique_ptr<ESPConfigStorage>{
+            new ESPConfigFileStorage{{cache.c_str()}, &hostFS}}};
+      }};
+      auto cold{timed([&]() {
+        stdfs::remove(cacheName);
+        boot();
+      })};
+      auto warm{timed(boot)};
+      printf("%s: %u B, cold boot %.1f us, warm boot %.1f us, %.0f%% saved "
+             "with ESPCONFIG_CACHEHASH %d\n",
+             file.path.c_str(), (unsigned)stdfs::file_size(file.path), cold,
+             warm, 100 * (1 - warm / cold), ESPCONFIG_CACHEHASH);
+      stdfs::remove(cacheName);
+    }
+#endif
+  }
+  stdfs::remove(cache);
+  return result;
+}
+
+// the keys and heap held by a config whose keys are all replaced by new ones
+// a number of rounds, before and after compact() drops the unused keys
+int benchKeys(const options_t& options) {
+  auto count{options.paths.empty()
+                 ? 1000ul
+                 : strtoul(options.paths[0].c_str(), nullptr, 0)};
+  if (count == 0) {
+    return -1;
+  }
+  ESPConfig config{std::unique_ptr<ESPConfigStorage>{new discardStorage}};
+  auto report{[&config](const char* step) {
+    auto stats{config.stats()};
+    printf("%-26s %7u keys %9u B held\n", step, (unsigned)stats.keys,
+           (unsigned)stats.bytesHeld);
+  }};
+  report("empty");
+  for (auto round{0u}; round < 4; round++) {
+    for (auto i{0ul}; i < count; i++) {
+      auto key{"key" + std::to_string(round * count + i)};
+      config.value(key.c_str(), (int32_t)i);
+    }
+    config.save();
+    if (round == 0) {
+      report("set");
+    }
+    config.reset();
+    config.save();
+  }
+  report("set and reset 4 times");
+  config.compact();
+  report("compacted");
+  return 0;
+}
+
+// read() of the JSON files given one at a time against ESPCONFIG_PARALLEL at
+// once through the file storage, both must read the same configuration
+int benchParallel(const options_t& options) {
+  std::vector<std::string> names;
+  for (const auto& file : findFiles(options, format_t::unknown)) {
+    if (fileFormat(file.path, options.from) == format_t::json) {
+      names.push_back(file.path);
+    }
+  }
+  if (names.empty()) {
+    return -1;
+  }
+  std::vector<const char*> files;
+  for (const auto& name : names) {
+    files.push_back(name.c_str());
+  }
+
+  auto read{[&files](uint8_t parallel) {
+    return ESPConfig{std::unique_ptr<ESPConfigStorage>{new ESPConfigFileStorage{
+        files, &hostFS, [](ESPConfig::fileSystem_t) {},
+        [](ESPConfig::fileSystem_t) {}, parallel}}};
+  }};
+  auto sequential{timed([&read]() { read(1); })};
+  auto parallel{timed([&read]() { read(ESPCONFIG_PARALLEL); })};
+  auto same{read(1).toJSON() == read(ESPCONFIG_PARALLEL).toJSON()};
+  printf("%u files, one at a time %.1f us, %u at once %.1f us, results %s\n",
+         (unsigned)files.size(), sequential, (unsigned)ESPCONFIG_PARALLEL,
+         parallel, same ? "match" : "DIFFER");
+  return same ? 0 : 1;
+}
+
+int bench(const options_t& options) {
+  if (options.paths.empty()) {
+    return -1;
+  }
+  auto rest{options};
+  rest.paths.erase(rest.paths.begin());
+  if (options.paths[0] == "cache" && !rest.paths.empty()) {
+    return benchCache(rest);
+  }
+  if (options.paths[0] == "keys") {
+    return benchKeys(rest);
+  }
+  if (options.paths[0] == "parallel" && !rest.paths.empty()) {
+    return benchParallel(rest);
+  }
+  return -1;
+}
+
+int usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s convert SOURCE OUTPUT [--from F] [--to F] [options]\n"
+          "       %s check PATH... [--from F] [options]\n"
+          "       %s batch PATH... --to F --out DIR [--from F] [options]\n"
+          "       %s bench cache PATH...\n"
+          "       %s bench keys [COUNT]\n"
+          "       %s bench parallel PATH...\n"
+          "formats: json, msgpack, eeprom, image\n"
+          "options: --offset N   the EEPROM offset, 0 by default\n"
+          "         --length N   the EEPROM bytes from the offset, to the end\n"
+          "                      of the ESPCONFIG_EEPROMSIZE area by default\n"
+          "built with ESPCONFIG_EEPROMSIZE %u, ESPCONFIG_JSONDOCSIZE %u, "
+          "ESPCONFIG_COMPRESS %d, %u bit\n",
+          name, name, name, name, name, name, (unsigned)m_eepromSize, (unsigned)m_jsonDocSize,
+          ESPCONFIG_COMPRESS, (unsigned)(sizeof(void*) * 8));
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    return usage(argv[0]);
+  }
+
+  std::string command{argv[1]};
+  options_t options;
+  for (auto i{2}; i < argc; i++) {
+    std::string arg{argv[i]};
+    auto next{[&]() -> std::string {
+      return i + 1 < argc ? argv[++i] : "";
+    }};
+    if (arg == "--from" || arg == "--to") {
+      auto found{formatNames.find(next())};
+      if (found == formatNames.end()) {
+        return usage(argv[0]);
+      }
+      (arg == "--from" ? options.from : options.to) = found->second;
+    } else if (arg == "--offset" || arg == "--length") {
+      auto value{strtoul(next().c_str(), nullptr, 0)};
+      if (value > UINT16_MAX) {
+        return usage(argv[0]);
+      }
+      (arg == "--offset" ? options.offset : options.length) = value;
+    } else if (arg == "--out") {
+      options.out = next();
+    } else if (arg.rfind("--", 0) == 0) {
+      return usage(argv[0]);
+    } else {
+      options.paths.push_back(arg);
+    }
+  }
+
+  auto result{-1};
+  if (command == "convert") {
+    result = convert(options);
+  } else if (command == "check" && !options.paths.empty()) {
+    result = check(options);
+  } else if (command == "batch" && !options.paths.empty()) {
+    result = batch(options);
+  } else if (command == "bench") {
+    result = bench(options);
+  }
+  return result < 0 ? usage(argv[0]) : result;
+}